@@ -1,12 +1,20 @@
 #pragma once
 #include <array>
 #include <cstddef>
+#include <cstdint>
 #include <stdexcept>
 #include <string>
 #include <vector>
 
 namespace shell::base64 {
 
+constexpr std::array<char, 64> kBase64EncTable = {
+    'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H', 'I', 'J', 'K', 'L', 'M', 'N', 'O', 'P',  //
+    'Q', 'R', 'S', 'T', 'U', 'V', 'W', 'X', 'Y', 'Z', 'a', 'b', 'c', 'd', 'e', 'f',  //
+    'g', 'h', 'i', 'j', 'k', 'l', 'm', 'n', 'o', 'p', 'q', 'r', 's', 't', 'u', 'v',  //
+    'w', 'x', 'y', 'z', '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', '+', '/'   //
+};
+
 constexpr std::array<int8_t, 256> kBase64DecTable = {
     -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  //
     -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  //
@@ -56,4 +64,26 @@ inline auto base64_decode(const std::string& s) -> std::vector<uint8_t> {
   return out;
 }
 
+// Standard alphabet with '=' padding and no line breaks.
+inline auto base64_encode(const std::vector<uint8_t>& data) -> std::string {
+  std::string out;
+  out.reserve((data.size() + 2) / 3 * 4);
+
+  for (size_t i = 0; i < data.size(); i += 3) {
+    const size_t remaining = data.size() - i;
+    uint32_t acc = static_cast<uint32_t>(data[i]) << 16;
+    if (remaining > 1) {
+      acc |= static_cast<uint32_t>(data[i + 1]) << 8;
+    }
+    if (remaining > 2) {
+      acc |= static_cast<uint32_t>(data[i + 2]);
+    }
+    out.push_back(kBase64EncTable[(acc >> 18) & 0x3Fu]);
+    out.push_back(kBase64EncTable[(acc >> 12) & 0x3Fu]);
+    out.push_back(remaining > 1 ? kBase64EncTable[(acc >> 6) & 0x3Fu] : '=');
+    out.push_back(remaining > 2 ? kBase64EncTable[acc & 0x3Fu] : '=');
+  }
+  return out;
+}
+
 }  // namespace shell::base64
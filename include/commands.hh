@@ -7,6 +7,7 @@
 auto do_help(const std::vector<std::string>& tokens) -> bool;
 auto do_sleep(const std::vector<std::string>& tokens) -> bool;
 auto do_connect(const std::vector<std::string>& tokens) -> bool;
+auto do_endpoint(const std::vector<std::string>& tokens) -> bool;
 auto do_add_detector(const std::vector<std::string>& tokens) -> bool;
 auto do_remove_detector(const std::vector<std::string>& tokens) -> bool;
 auto do_add_router(const std::vector<std::string>& tokens) -> bool;
@@ -21,9 +22,11 @@ auto do_set(const std::vector<std::string>& tokens) -> bool;
 auto do_configure_fpga(const std::vector<std::string>& tokens) -> bool;
 auto do_get(const std::vector<std::string>& tokens) -> bool;
 auto do_set_vareg(const std::vector<std::string>& tokens) -> bool;
+auto do_disable_channels(const std::vector<std::string>& tokens) -> bool;
 auto do_show(const std::vector<std::string>& tokens) -> bool;
 auto do_readout(const std::vector<std::string>& tokens) -> bool;
 auto do_pedcalib_readout(const std::vector<std::string>& tokens) -> bool;
+auto do_quicklook(const std::vector<std::string>& tokens) -> bool;
 auto readout_prompt_progress() -> std::optional<std::string>;
 void emit_readout_message(const std::string& message, bool error = false);
 void shutdown_readout();
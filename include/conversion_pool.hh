@@ -0,0 +1,206 @@
+#pragma once
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+
+#include <cerrno>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Queue, worker and result counts of a ConversionPool.
+struct ConversionStats {
+  size_t queued = 0;
+  size_t running = 0;
+  uint64_t done = 0;
+  uint64_t failed = 0;
+};
+
+// Runs a converter program (raw2root) on finished readout files in the
+// background, at most `jobs` at a time. Each conversion is a child process
+// with the lowest CPU priority and idle I/O priority, so it only uses what
+// the readout leaves over; its output goes to <input>.convert.log.
+//
+// Submit is thread-safe and never blocks, so the readout writer threads can
+// queue a file the moment it is closed.
+class ConversionPool {
+ public:
+  // Called on a pool thread after each conversion; detail describes a failure.
+  using OnFinished = std::function<void(const std::string& input, bool ok,
+                                        const std::string& detail)>;
+
+  ConversionPool(std::string program, std::vector<std::string> arguments, size_t jobs,
+                 OnFinished on_finished)
+      : program_(std::move(program)),
+        arguments_(std::move(arguments)),
+        on_finished_(std::move(on_finished)) {
+    for (size_t i = 0; i < jobs; ++i) {
+      workers_.emplace_back([this]() { Run(); });
+    }
+  }
+
+  ConversionPool(const ConversionPool&) = delete;
+  ConversionPool(ConversionPool&&) = delete;
+  auto operator=(const ConversionPool&) -> ConversionPool& = delete;
+  auto operator=(ConversionPool&&) -> ConversionPool& = delete;
+  ~ConversionPool() {
+    Cancel();
+    Wait();
+  }
+
+  void Submit(std::string input) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (closing_) {
+        return;
+      }
+      queue_.push_back(std::move(input));
+    }
+    ready_.notify_one();
+  }
+
+  // Drops the conversions that have not started; running ones complete.
+  void Cancel() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    queue_.clear();
+  }
+
+  // Accepts no more files, runs what is queued, and joins the workers.
+  void Wait() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      closing_ = true;
+    }
+    ready_.notify_all();
+    for (auto& worker : workers_) {
+      if (worker.joinable()) {
+        worker.join();
+      }
+    }
+  }
+
+  [[nodiscard]] auto Stats() const -> ConversionStats {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return {queue_.size(), running_, done_, failed_};
+  }
+
+  [[nodiscard]] auto Idle() const -> bool {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return queue_.empty() && running_ == 0;
+  }
+
+ private:
+  void Run() {
+    while (true) {
+      std::string input;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        ready_.wait(lock, [this]() { return closing_ || !queue_.empty(); });
+        if (queue_.empty()) {
+          return;
+        }
+        input = std::move(queue_.front());
+        queue_.pop_front();
+        ++running_;
+      }
+      std::string detail;
+      const bool ok = Convert(input, detail);
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        --running_;
+        ++(ok ? done_ : failed_);
+      }
+      if (on_finished_) {
+        on_finished_(input, ok, detail);
+      }
+    }
+  }
+
+  // Only async-signal-safe calls between fork and exec: everything the child
+  // needs is prepared here.
+  auto Convert(const std::string& input, std::string& detail) const -> bool {
+    const std::string log_path = input + ".convert.log";
+    std::vector<std::string> args;
+    args.push_back(program_);
+    args.insert(args.end(), arguments_.begin(), arguments_.end());
+    args.push_back(input);
+    std::vector<char*> argv;
+    for (auto& arg : args) {
+      argv.push_back(arg.data());
+    }
+    argv.push_back(nullptr);
+
+    const pid_t pid = ::fork();
+    if (pid < 0) {
+      detail = std::string("fork: ") + std::strerror(errno);
+      return false;
+    }
+    if (pid == 0) {
+      LowerPriority();
+      const int log = ::open(log_path.c_str(),  // NOLINT
+                             O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+      const int null = ::open("/dev/null", O_RDONLY | O_CLOEXEC);  // NOLINT
+      if (log >= 0) {
+        ::dup2(log, STDOUT_FILENO);
+        ::dup2(log, STDERR_FILENO);
+      }
+      if (null >= 0) {
+        ::dup2(null, STDIN_FILENO);
+      }
+      ::execvp(argv[0], argv.data());
+      ::_exit(127);
+    }
+
+    int status = 0;
+    while (::waitpid(pid, &status, 0) < 0) {
+      if (errno != EINTR) {
+        detail = std::string("waitpid: ") + std::strerror(errno);
+        return false;
+      }
+    }
+    if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+      return true;
+    }
+    detail = WIFEXITED(status) ? "exit status " + std::to_string(WEXITSTATUS(status))
+                               : "killed by signal " + std::to_string(WTERMSIG(status));
+    detail += ", see " + log_path;
+    return false;
+  }
+
+  // Nice 19 and, where the platform has one, the idle I/O class.
+  static void LowerPriority() {
+    (void)::setpriority(PRIO_PROCESS, 0, 19);
+#if defined(__linux__) && defined(SYS_ioprio_set)
+    constexpr int kIoprioWhoProcess = 1;
+    constexpr int kIoprioClassIdle = 3;
+    constexpr int kIoprioClassShift = 13;
+    (void)::syscall(SYS_ioprio_set, kIoprioWhoProcess, 0, kIoprioClassIdle << kIoprioClassShift);
+#elif defined(__APPLE__)
+    (void)::setiopolicy_np(IOPOL_TYPE_DISK, IOPOL_SCOPE_PROCESS, IOPOL_THROTTLE);
+#endif
+  }
+
+  std::string program_;
+  std::vector<std::string> arguments_;
+  OnFinished on_finished_;
+  mutable std::mutex mutex_;
+  std::condition_variable ready_;
+  std::deque<std::string> queue_;
+  size_t running_ = 0;
+  uint64_t done_ = 0;
+  uint64_t failed_ = 0;
+  bool closing_ = false;
+  std::vector<std::thread> workers_;
+};
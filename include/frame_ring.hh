@@ -0,0 +1,101 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Lock-free single-producer/single-consumer ring of preallocated frame slots.
+//
+// The producer moves a frame into the next free slot and publishes it with a
+// release store of head_; the consumer uses the slot in place and frees it
+// with a release store of tail_. Each side keeps a cached copy of the other
+// side's index, so the shared cache lines are only read when the ring looks
+// full (producer) or empty (consumer). The slots are constructed once; a
+// Frame whose move assignment does not allocate (a string, a Cord) keeps the
+// ring allocation-free after construction.
+template <typename Frame>
+class FrameRing {
+ public:
+  // slots is rounded up to a power of two.
+  explicit FrameRing(size_t slots)
+      : mask_(RoundUp(std::max<size_t>(slots, 2)) - 1), slots_(mask_ + 1) {}
+
+  FrameRing(const FrameRing&) = delete;
+  FrameRing(FrameRing&&) = delete;
+  auto operator=(const FrameRing&) -> FrameRing& = delete;
+  auto operator=(FrameRing&&) -> FrameRing& = delete;
+  ~FrameRing() = default;
+
+  // Producer only. Moves frame into the ring, or leaves it untouched and
+  // returns false when every slot is in use.
+  auto TryPush(Frame& frame) -> bool {
+    const uint64_t head = head_.load(std::memory_order_relaxed);
+    if (head - cached_tail_ > mask_) {
+      cached_tail_ = tail_.load(std::memory_order_acquire);
+      if (head - cached_tail_ > mask_) {
+        return false;
+      }
+    }
+    slots_[head & mask_] = std::move(frame);
+    head_.store(head + 1, std::memory_order_release);
+    const uint64_t used = head + 1 - cached_tail_;
+    if (used > high_water_.load(std::memory_order_relaxed)) {
+      high_water_.store(used, std::memory_order_relaxed);
+    }
+    return true;
+  }
+
+  // Consumer only. The oldest frame, valid until Pop, or nullptr.
+  [[nodiscard]] auto Front() -> Frame* {
+    const uint64_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail == cached_head_) {
+      cached_head_ = head_.load(std::memory_order_acquire);
+      if (tail == cached_head_) {
+        return nullptr;
+      }
+    }
+    return &slots_[tail & mask_];
+  }
+
+  // Consumer only. Releases what the slot returned by Front holds and frees it.
+  void Pop() {
+    const uint64_t tail = tail_.load(std::memory_order_relaxed);
+    slots_[tail & mask_] = Frame();
+    tail_.store(tail + 1, std::memory_order_release);
+  }
+
+  // Any thread; approximate while both sides are running.
+  [[nodiscard]] auto Size() const -> size_t {
+    const uint64_t tail = tail_.load(std::memory_order_acquire);
+    const uint64_t head = head_.load(std::memory_order_acquire);
+    return static_cast<size_t>(head >= tail ? head - tail : 0);
+  }
+  [[nodiscard]] auto Capacity() const -> size_t { return mask_ + 1; }
+  [[nodiscard]] auto HighWater() const -> size_t {
+    return static_cast<size_t>(high_water_.load(std::memory_order_relaxed));
+  }
+
+ private:
+  static constexpr size_t kCacheLine = 64;
+
+  static auto RoundUp(size_t value) -> size_t {
+    size_t power = 1;
+    while (power < value) {
+      power <<= 1U;
+    }
+    return power;
+  }
+
+  const size_t mask_;
+  std::vector<Frame> slots_;
+
+  // Written by the producer.
+  alignas(kCacheLine) std::atomic<uint64_t> head_{0};
+  uint64_t cached_tail_ = 0;
+  std::atomic<uint64_t> high_water_{0};
+  // Written by the consumer.
+  alignas(kCacheLine) std::atomic<uint64_t> tail_{0};
+  uint64_t cached_head_ = 0;
+};
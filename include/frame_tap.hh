@@ -0,0 +1,103 @@
+#pragma once
+#include <absl/strings/cord.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <utility>
+
+// Hands received frames from the readout writers to a consumer running on its
+// own thread. Push never blocks: when the consumer falls behind by more than
+// `capacity` frames, new frames are dropped and counted, so online analysis
+// can never slow down or stall the disk writer. Frames are shared Cords, so
+// Push copies no payload; the worker flattens each one for the consumer.
+// A consumer that throws loses that frame only: the exception is counted in
+// Failed() and the worker carries on, since it would otherwise terminate the
+// shell in the middle of an acquisition.
+class FrameTap {
+ public:
+  using Consumer = std::function<void(uint8_t logical_address, std::string_view frame)>;
+
+  // 512 frames of 32 KiB bound the queue to 16 MiB.
+  static constexpr size_t kDefaultCapacity = 512;
+
+  explicit FrameTap(Consumer consumer, size_t capacity = kDefaultCapacity)
+      : consumer_(std::move(consumer)), capacity_(capacity), worker_([this]() { Run(); }) {}
+
+  FrameTap(const FrameTap&) = delete;
+  FrameTap(FrameTap&&) = delete;
+  auto operator=(const FrameTap&) -> FrameTap& = delete;
+  auto operator=(FrameTap&&) -> FrameTap& = delete;
+  ~FrameTap() { Stop(); }
+
+  void Push(uint8_t logical_address, absl::Cord frame) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (stopping_ || queue_.size() >= capacity_) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+      }
+      queue_.emplace_back(logical_address, std::move(frame));
+    }
+    ready_.notify_one();
+  }
+
+  // Consumes every frame already queued, then joins the worker.
+  void Stop() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    ready_.notify_one();
+    if (worker_.joinable()) {
+      worker_.join();
+    }
+  }
+
+  [[nodiscard]] auto Consumed() const -> uint64_t {
+    return consumed_.load(std::memory_order_relaxed);
+  }
+  [[nodiscard]] auto Dropped() const -> uint64_t { return dropped_.load(std::memory_order_relaxed); }
+  [[nodiscard]] auto Failed() const -> uint64_t { return failed_.load(std::memory_order_relaxed); }
+
+ private:
+  void Run() {
+    while (true) {
+      std::pair<uint8_t, absl::Cord> item;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        ready_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+        if (queue_.empty()) {
+          return;
+        }
+        item = std::move(queue_.front());
+        queue_.pop_front();
+      }
+      const auto frame = item.second.Flatten();
+      try {
+        consumer_(item.first, std::string_view(frame.data(), frame.size()));
+      } catch (const std::exception&) {
+        failed_.fetch_add(1, std::memory_order_relaxed);
+      }
+      consumed_.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  Consumer consumer_;
+  size_t capacity_ = kDefaultCapacity;
+  std::mutex mutex_;
+  std::condition_variable ready_;
+  std::deque<std::pair<uint8_t, absl::Cord>> queue_;
+  bool stopping_ = false;
+  std::atomic<uint64_t> consumed_{0};
+  std::atomic<uint64_t> dropped_{0};
+  std::atomic<uint64_t> failed_{0};
+  std::thread worker_;
+};
@@ -27,13 +27,24 @@ extern std::atomic<bool> g_readout_stop_requested;
 extern bool g_interactive_shell;
 extern std::thread::id g_shell_thread_id;
 extern std::shared_ptr<grpc::Channel> g_channel;
-extern std::unique_ptr<superhero::CommunicationService::Stub> g_stub;
+extern std::shared_ptr<superhero::CommunicationService::Stub> g_stub;
 extern ShellState g_current_state;
 extern std::string g_current_endpoint;
+extern std::string g_current_endpoint_name;
 extern int g_router_count;
 extern int g_detector_count;
 extern std::vector<std::string> g_candidate;
 
+// One named connection to a CdTeDE server. Device and configuration commands
+// act on the current endpoint, whose channel and stub are g_channel/g_stub;
+// readout streams from every endpoint at once.
+struct Endpoint {
+  std::string target;  // host:port
+  std::shared_ptr<grpc::Channel> channel;
+  std::shared_ptr<superhero::CommunicationService::Stub> stub;
+};
+extern std::map<std::string, Endpoint> g_endpoints;  // by name
+
 // Single source of truth for command metadata: availability (states), the
 // categorized `help` listing (category/summary), and `help <command>` (help).
 // Entries are grouped by category; do_help prints a header when it changes.
@@ -63,8 +74,11 @@ struct DeviceStatusInfo {
 void log_grpc_error(const std::string& api, const grpc::Status& status);
 void update_device_counts();
 void refresh_state_after_device_change();
+void use_endpoint(const std::string& name);
 auto build_prompt() -> PromptInfo;
 auto get_detector_logical_addresses() -> std::optional<std::vector<uint8_t>>;
+auto get_detector_logical_addresses(superhero::CommunicationService::Stub& stub)
+    -> std::optional<std::vector<uint8_t>>;
 auto get_router_logical_addresses() -> std::optional<std::vector<uint8_t>>;
 auto get_device_logical_addresses() -> std::optional<std::vector<uint8_t>>;
 auto get_device_statuses() -> std::optional<std::vector<DeviceStatusInfo>>;
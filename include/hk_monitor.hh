@@ -0,0 +1,77 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include "hk_frame.hh"
+
+// Latest HK values of a running readout. Every HK frame is decoded through
+// hk_frame::kFields into a ring of the last kHistory frames of its logical
+// address, so readout status shows current values and their recent range
+// while the run is still going. HK frames arrive a few times per second, so
+// a lock is cheap; Record is called from every detector's HK writer thread.
+class HkMonitor {
+ public:
+  static constexpr size_t kHistory = 64;
+
+  struct Summary {
+    uint8_t address = 0;
+    uint64_t frames = 0;
+    std::chrono::steady_clock::time_point received{};
+    hk_frame::Values latest{};
+    // Range over the frames still in the ring.
+    hk_frame::Values min{};
+    hk_frame::Values max{};
+    size_t samples = 0;
+  };
+
+  // frame must hold hk_frame::kFrameBytes bytes.
+  void Record(uint8_t address, const char* frame) {
+    const auto values = hk_frame::decode(frame);
+    const auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& ring = rings_[address];
+    ring.values[ring.frames % kHistory] = values;
+    ring.received = now;
+    ++ring.frames;
+  }
+
+  [[nodiscard]] auto Summaries() const -> std::vector<Summary> {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<Summary> summaries;
+    for (const auto& [address, ring] : rings_) {
+      Summary summary;
+      summary.address = address;
+      summary.frames = ring.frames;
+      summary.received = ring.received;
+      summary.latest = ring.values[(ring.frames - 1) % kHistory];
+      summary.samples = static_cast<size_t>(std::min<uint64_t>(ring.frames, kHistory));
+      summary.min = summary.latest;
+      summary.max = summary.latest;
+      for (size_t i = 0; i < summary.samples; ++i) {
+        for (size_t field = 0; field < hk_frame::kFields.size(); ++field) {
+          summary.min[field] = std::min(summary.min[field], ring.values[i][field]);
+          summary.max[field] = std::max(summary.max[field], ring.values[i][field]);
+        }
+      }
+      summaries.push_back(summary);
+    }
+    return summaries;
+  }
+
+ private:
+  struct Ring {
+    std::array<hk_frame::Values, kHistory> values{};
+    uint64_t frames = 0;
+    std::chrono::steady_clock::time_point received{};
+  };
+
+  mutable std::mutex mutex_;
+  std::map<uint8_t, Ring> rings_;
+};
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "channel_table.hh"
+#include "decode_pipeline.hh"
+
+// Per-hit values derived from one event. Channels without a hit are zero.
+struct CalibratedEvent {
+  std::array<std::array<float, kChannelNum>, kAsicNum> pha{};
+  std::array<std::array<float, kChannelNum>, kAsicNum> epi{};
+};
+
+// pha = ADC - CMN - pedestal[ch] and, with a gain table, epi = pha * gain[ch] + offset[ch].
+//
+// The tables are stored as float rows so the per-ASIC loops below have no
+// branches and compile to packed arithmetic over the 64 channels.
+class Calibration {
+ public:
+  explicit Calibration(const std::string& pedestal_file)
+      : pedestal_(ToFloat(load_channel_table(pedestal_file))) {}
+
+  // Gain file: 256 values (gain per ADC channel) or 512 values (gains followed
+  // by offsets), both in the 4x64 calc_pedestal layout.
+  void LoadGain(const std::string& gain_file) {
+    std::ifstream file(gain_file);
+    if (!file.is_open()) {
+      throw std::runtime_error("Could not open gain table " + gain_file);
+    }
+    std::vector<double> values;
+    double value = 0.0;
+    while (file >> value) {
+      values.push_back(value);
+    }
+    if (!file.eof()) {
+      throw std::runtime_error("Gain table " + gain_file + " contains a non-numeric value");
+    }
+    constexpr size_t kTableSize = kAsicNum * kChannelNum;
+    if (values.size() != kTableSize && values.size() != 2 * kTableSize) {
+      throw std::runtime_error("Gain table " + gain_file + " needs " +
+                               std::to_string(kTableSize) + " or " +
+                               std::to_string(2 * kTableSize) + " values");
+    }
+    FloatTable gain{};
+    FloatTable offset{};
+    for (size_t i = 0; i < kTableSize; ++i) {
+      gain[i / kChannelNum][i % kChannelNum] = static_cast<float>(values[i]);  // NOLINT
+      if (values.size() == 2 * kTableSize) {
+        offset[i / kChannelNum][i % kChannelNum] =  // NOLINT
+            static_cast<float>(values[kTableSize + i]);
+      }
+    }
+    gain_ = gain;
+    offset_ = offset;
+  }
+
+  [[nodiscard]] auto HasGain() const -> bool { return gain_.has_value(); }
+
+  // common_mode replaces the hardware CMN word per ASIC when given.
+  void Apply(const DecodedEvent& event, CalibratedEvent& out,
+             const std::array<float, kAsicNum>* common_mode = nullptr) const {
+    for (size_t asic = 0; asic < kAsicNum; ++asic) {
+      const auto& data = event.asic_data[asic];  // NOLINT
+      const uint64_t hits = data.chflag.to_ullong();
+      const auto cmn =
+          common_mode != nullptr ? (*common_mode)[asic] : static_cast<float>(data.cmn);  // NOLINT
+      const auto& pedestal = pedestal_[asic];  // NOLINT
+      auto& pha = out.pha[asic];               // NOLINT
+      for (size_t channel = 0; channel < kChannelNum; ++channel) {
+        const auto hit = static_cast<float>((hits >> channel) & 1U);
+        pha[channel] = hit * (static_cast<float>(data.adc_data[channel]) - cmn -  // NOLINT
+                              pedestal[channel]);                               // NOLINT
+      }
+      if (!gain_) {
+        continue;
+      }
+      const auto& gain = (*gain_)[asic];      // NOLINT
+      const auto& offset = (*offset_)[asic];  // NOLINT
+      auto& epi = out.epi[asic];              // NOLINT
+      for (size_t channel = 0; channel < kChannelNum; ++channel) {
+        const auto hit = static_cast<float>((hits >> channel) & 1U);
+        epi[channel] = pha[channel] * gain[channel] + hit * offset[channel];  // NOLINT
+      }
+    }
+  }
+
+  // Table contents, stored (hashed) with conversion checkpoints so a resumed
+  // run never appends values computed with other tables.
+  [[nodiscard]] auto Describe() const -> std::string {
+    std::ostringstream out;
+    out << "pedestal=";
+    AppendTable(out, pedestal_);
+    if (gain_) {
+      out << "gain=";
+      AppendTable(out, *gain_);
+      out << "offset=";
+      AppendTable(out, *offset_);
+    }
+    return out.str();
+  }
+
+ private:
+  using FloatTable = std::array<std::array<float, kChannelNum>, kAsicNum>;
+
+  static void AppendTable(std::ostringstream& out, const FloatTable& table) {
+    for (const auto& asic : table) {
+      for (const float value : asic) {
+        out << value << ',';
+      }
+    }
+    out << ';';
+  }
+
+  static auto ToFloat(const ChannelTable& table) -> FloatTable {
+    FloatTable result{};
+    for (size_t asic = 0; asic < kAsicNum; ++asic) {
+      for (size_t channel = 0; channel < kChannelNum; ++channel) {
+        result[asic][channel] = static_cast<float>(table[asic][channel]);  // NOLINT
+      }
+    }
+    return result;
+  }
+
+  FloatTable pedestal_{};
+  std::optional<FloatTable> gain_;
+  std::optional<FloatTable> offset_;
+};
@@ -0,0 +1,259 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <ostream>
+#include <vector>
+
+#include "common_mode.hh"
+#include "decode_pipeline.hh"
+#include "pedestal_sink.hh"
+
+enum class ChannelStatus { kOk, kDead, kStuck, kNoisy, kHot };
+
+inline auto channel_status_name(ChannelStatus status) -> const char* {
+  switch (status) {
+    case ChannelStatus::kOk:
+      return "ok";
+    case ChannelStatus::kDead:
+      return "dead";
+    case ChannelStatus::kStuck:
+      return "stuck";
+    case ChannelStatus::kNoisy:
+      return "noisy";
+    case ChannelStatus::kHot:
+      return "hot";
+  }
+  return "ok";
+}
+
+// Characterization of one channel over a run. Values are ADC-CMN, with the
+// CMN selected as for PedestalSink.
+struct ChannelStats {
+  uint64_t hits = 0;
+  double occupancy = 0.0;
+  std::optional<double> median;
+  double mad = 0.0;  // median absolute deviation from the median
+  double mean = 0.0;
+  double sigma = 0.0;
+  int min = 0;
+  int max = 0;
+  // Range of the raw ADC, before the CMN is subtracted.
+  int raw_min = 0;
+  int raw_max = 0;
+  ChannelStatus status = ChannelStatus::kOk;
+};
+
+// Noise, occupancy and bad-channel characterization in one streaming pass.
+//
+// Each channel keeps the pedestal histogram (for the median and MAD) and
+// Welford running moments (for mean and sigma), so memory is flat and one
+// pass replaces the separate median, noise and occupancy macros. Channels
+// are then classified against the other live channels of their ASIC:
+//
+//   dead   never hit
+//   stuck  hit, but the raw ADC always the same value
+//   noisy  sigma above noisy_factor times the ASIC's median sigma
+//   hot    occupancy above hot_factor times the ASIC's median occupancy
+//
+// Stuck is judged on the raw ADC: ADC-CMN of a frozen channel still follows
+// the CMN. A channel needs kMinClassifyHits hits to be called stuck, noisy or
+// hot; with fewer it stays ok, and its sigma does not enter the ASIC median.
+class ChannelStatsSink : public EventSink {
+ public:
+  static constexpr double kDefaultNoisyFactor = 3.0;
+  static constexpr double kDefaultHotFactor = 3.0;
+  static constexpr uint64_t kMinClassifyHits = 16;
+
+  explicit ChannelStatsSink(size_t max_events = PedestalSink::kUnlimited,
+                            double noisy_factor = kDefaultNoisyFactor,
+                            double hot_factor = kDefaultHotFactor,
+                            const CommonModeEstimator& common_mode = CommonModeEstimator())
+      : max_events_(max_events),
+        noisy_factor_(noisy_factor),
+        hot_factor_(hot_factor),
+        common_mode_(common_mode) {}
+
+  void OnEvent(const DecodedEvent& event, size_t /*frame_index*/) override {
+    if (!event.valid || Done()) {
+      return;
+    }
+    ++event_count_;
+    for (size_t asic = 0; asic < kAsicNum; ++asic) {
+      const auto& data = event.asic_data[asic];  // NOLINT
+      const float cmn = common_mode_.Estimate(data, asic);
+      for (size_t channel = 0; channel < kChannelNum; ++channel) {
+        if (!data.chflag.test(channel)) {
+          continue;
+        }
+        const int raw = data.adc_data[channel];  // NOLINT
+        const auto value = static_cast<int>(std::lround(raw - cmn));
+        const size_t index = asic * kChannelNum + channel;
+        const int bin = std::clamp(value + PedestalSink::kOffset, 0,
+                                   static_cast<int>(PedestalSink::kBins) - 1);
+        ++histograms_[index][static_cast<size_t>(bin)];  // NOLINT
+
+        auto& moments = moments_[index];  // NOLINT
+        ++moments.count;
+        const double delta = value - moments.mean;
+        moments.mean += delta / static_cast<double>(moments.count);
+        moments.m2 += delta * (value - moments.mean);
+        moments.min = moments.count == 1 ? value : std::min(moments.min, value);
+        moments.max = moments.count == 1 ? value : std::max(moments.max, value);
+        moments.raw_min = moments.count == 1 ? raw : std::min(moments.raw_min, raw);
+        moments.raw_max = moments.count == 1 ? raw : std::max(moments.raw_max, raw);
+      }
+    }
+  }
+
+  [[nodiscard]] auto Done() const -> bool override { return event_count_ >= max_events_; }
+  [[nodiscard]] auto EventCount() const -> size_t { return event_count_; }
+  // ADC-CMN counts of one channel, bin = value + PedestalSink::kOffset.
+  [[nodiscard]] auto Histogram(size_t asic, size_t channel) const
+      -> const PedestalSink::Histogram& {
+    return histograms_[asic * kChannelNum + channel];  // NOLINT
+  }
+
+  // Statistics of every channel, indexed asic * kChannelNum + channel.
+  [[nodiscard]] auto Stats() const -> std::vector<ChannelStats> {
+    std::vector<ChannelStats> stats(kAsicNum * kChannelNum);
+    for (size_t index = 0; index < stats.size(); ++index) {
+      const auto& moments = moments_[index];  // NOLINT
+      auto& channel = stats[index];
+      channel.hits = moments.count;
+      channel.occupancy =
+          event_count_ > 0 ? static_cast<double>(moments.count) / static_cast<double>(event_count_)
+                           : 0.0;
+      channel.median = PedestalSink::Median(histograms_[index]);  // NOLINT
+      if (channel.median) {
+        channel.mad = Mad(histograms_[index], *channel.median);  // NOLINT
+      }
+      channel.mean = moments.mean;
+      channel.sigma = moments.count > 1
+                          ? std::sqrt(moments.m2 / static_cast<double>(moments.count - 1))
+                          : 0.0;
+      channel.min = moments.min;
+      channel.max = moments.max;
+      channel.raw_min = moments.raw_min;
+      channel.raw_max = moments.raw_max;
+    }
+    for (size_t asic = 0; asic < kAsicNum; ++asic) {
+      Classify(stats.begin() + static_cast<std::ptrdiff_t>(asic * kChannelNum));
+    }
+    return stats;
+  }
+
+  // One line per channel after a '#' header naming the columns.
+  void WriteMap(std::ostream& out) const {
+    const auto stats = Stats();
+    out << "# asic channel status hits occupancy median mad mean sigma min max raw_min raw_max\n";
+    for (size_t index = 0; index < stats.size(); ++index) {
+      const auto& channel = stats[index];
+      out << index / kChannelNum << ' ' << index % kChannelNum << ' '
+          << channel_status_name(channel.status) << ' ' << channel.hits << ' '
+          << channel.occupancy << ' ';
+      if (channel.median) {
+        out << *channel.median;
+      } else {
+        out << "nan";
+      }
+      out << ' ' << channel.mad << ' ' << channel.mean << ' ' << channel.sigma << ' '
+          << channel.min << ' ' << channel.max << ' ' << channel.raw_min << ' ' << channel.raw_max
+          << '\n';
+    }
+  }
+
+ private:
+  struct Moments {
+    uint64_t count = 0;
+    double mean = 0.0;
+    double m2 = 0.0;
+    int min = 0;
+    int max = 0;
+    int raw_min = 0;
+    int raw_max = 0;
+  };
+
+  // Median of |value - median|. Distances are multiples of 0.5, so they are
+  // counted in half-unit bins.
+  static auto Mad(const PedestalSink::Histogram& histogram, double median) -> double {
+    std::vector<uint64_t> distances(2 * PedestalSink::kBins + 1);
+    uint64_t total = 0;
+    for (size_t bin = 0; bin < PedestalSink::kBins; ++bin) {
+      if (histogram[bin] == 0) {  // NOLINT
+        continue;
+      }
+      const double value = static_cast<double>(bin) - PedestalSink::kOffset;
+      distances[static_cast<size_t>(std::lround(std::fabs(value - median) * 2.0))] +=
+          histogram[bin];  // NOLINT
+      total += histogram[bin];  // NOLINT
+    }
+    const uint64_t lower_rank = (total - 1) / 2;
+    const uint64_t upper_rank = total / 2;
+    std::optional<size_t> lower;
+    uint64_t seen = 0;
+    for (size_t half = 0; half < distances.size(); ++half) {
+      seen += distances[half];
+      if (!lower && seen > lower_rank) {
+        lower = half;
+      }
+      if (seen > upper_rank) {
+        return static_cast<double>(*lower + half) / 4.0;
+      }
+    }
+    return 0.0;
+  }
+
+  static auto MedianOf(std::vector<double> values) -> double {
+    if (values.empty()) {
+      return 0.0;
+    }
+    std::sort(values.begin(), values.end());
+    const size_t middle = values.size() / 2;
+    return values.size() % 2 == 1 ? values[middle] : (values[middle - 1] + values[middle]) / 2.0;
+  }
+
+  void Classify(std::vector<ChannelStats>::iterator asic) const {
+    std::vector<double> sigmas;
+    std::vector<double> occupancies;
+    for (size_t channel = 0; channel < kChannelNum; ++channel) {
+      auto& stats = asic[static_cast<std::ptrdiff_t>(channel)];
+      if (stats.hits == 0) {
+        stats.status = ChannelStatus::kDead;
+      } else if (stats.hits < kMinClassifyHits) {
+        occupancies.push_back(stats.occupancy);
+      } else if (stats.raw_min == stats.raw_max) {
+        stats.status = ChannelStatus::kStuck;
+      } else {
+        sigmas.push_back(stats.sigma);
+        occupancies.push_back(stats.occupancy);
+      }
+    }
+    const double typical_sigma = MedianOf(sigmas);
+    const double typical_occupancy = MedianOf(occupancies);
+    for (size_t channel = 0; channel < kChannelNum; ++channel) {
+      auto& stats = asic[static_cast<std::ptrdiff_t>(channel)];
+      if (stats.status != ChannelStatus::kOk || stats.hits < kMinClassifyHits) {
+        continue;
+      }
+      if (typical_sigma > 0.0 && stats.sigma > noisy_factor_ * typical_sigma) {
+        stats.status = ChannelStatus::kNoisy;
+      } else if (typical_occupancy > 0.0 && stats.occupancy > hot_factor_ * typical_occupancy) {
+        stats.status = ChannelStatus::kHot;
+      }
+    }
+  }
+
+  // Indexed asic * kChannelNum + channel, like PedestalSink.
+  std::vector<PedestalSink::Histogram> histograms_ =
+      std::vector<PedestalSink::Histogram>(kAsicNum * kChannelNum);
+  std::vector<Moments> moments_ = std::vector<Moments>(kAsicNum * kChannelNum);
+  size_t max_events_ = PedestalSink::kUnlimited;
+  double noisy_factor_ = kDefaultNoisyFactor;
+  double hot_factor_ = kDefaultHotFactor;
+  CommonModeEstimator common_mode_;
+  size_t event_count_ = 0;
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <fstream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+
+#include "detector_constants.hh"
+
+// One value per channel, indexed [asic][channel].
+using ChannelTable = std::array<std::array<double, kChannelNum>, kAsicNum>;
+
+// Reads the whitespace separated 4x64 layout written by calc_pedestal: one
+// line per ASIC, 64 values per line.
+inline auto load_channel_table(const std::string& path) -> ChannelTable {
+  std::ifstream file(path);
+  if (!file.is_open()) {
+    throw std::runtime_error("Could not open channel table " + path);
+  }
+  ChannelTable table{};
+  for (auto& asic : table) {
+    for (auto& value : asic) {
+      if (!(file >> value)) {
+        throw std::runtime_error("Channel table " + path + " needs " +
+                                 std::to_string(kAsicNum * kChannelNum) + " values");
+      }
+    }
+  }
+  std::string extra;
+  if (file >> extra) {
+    throw std::runtime_error("Channel table " + path + " has more than " +
+                             std::to_string(kAsicNum * kChannelNum) + " values");
+  }
+  return table;
+}
+
+// Writes the layout load_channel_table reads.
+inline void write_channel_table(std::ostream& out, const ChannelTable& table) {
+  for (const auto& asic : table) {
+    for (size_t channel = 0; channel < asic.size(); ++channel) {
+      out << asic[channel] << (channel + 1U == asic.size() ? '\n' : ' ');  // NOLINT
+    }
+  }
+}
+
+inline auto uniform_channel_table(double value) -> ChannelTable {
+  ChannelTable table{};
+  for (auto& asic : table) {
+    asic.fill(value);
+  }
+  return table;
+}
@@ -0,0 +1,190 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+#include "channel_table.hh"
+#include "decode_pipeline.hh"
+
+// Which common mode is subtracted from ADC values: the CMN word the ASIC
+// reports, or one recomputed in software from the event's own channels.
+enum class CommonModeMethod { kHardware, kMedian, kTruncatedMean };
+
+inline auto parse_common_mode(const std::string& name) -> CommonModeMethod {
+  if (name == "hardware") {
+    return CommonModeMethod::kHardware;
+  }
+  if (name == "median") {
+    return CommonModeMethod::kMedian;
+  }
+  if (name == "mean") {
+    return CommonModeMethod::kTruncatedMean;
+  }
+  throw std::invalid_argument("Unknown common mode '" + name +
+                              "' (expected hardware, median, mean)");
+}
+
+inline auto common_mode_name(CommonModeMethod method) -> const char* {
+  switch (method) {
+    case CommonModeMethod::kHardware:
+      return "hardware";
+    case CommonModeMethod::kMedian:
+      return "median";
+    case CommonModeMethod::kTruncatedMean:
+      return "mean";
+  }
+  return "hardware";
+}
+
+namespace common_mode_detail {
+
+using Lanes = std::array<int16_t, kChannelNum>;
+
+// One compare-exchange stage of the bitonic network. Size and Stride are
+// compile-time constants, so every block is a min/max over two contiguous
+// runs of lanes, written to a separate array so the loads and stores cannot
+// alias; the compiler turns the runs into packed 16-bit min/max.
+template <size_t Size, size_t Stride>
+inline void BitonicStage(Lanes& lanes) {
+  Lanes out;
+  for (size_t block = 0; block < kChannelNum; block += 2 * Stride) {
+    const bool ascending = (block & Size) == 0;
+    for (size_t i = 0; i < Stride; ++i) {
+      const int16_t a = lanes[block + i];           // NOLINT
+      const int16_t b = lanes[block + Stride + i];  // NOLINT
+      const int16_t low = std::min(a, b);
+      const int16_t high = std::max(a, b);
+      out[block + i] = ascending ? low : high;           // NOLINT
+      out[block + Stride + i] = ascending ? high : low;  // NOLINT
+    }
+  }
+  lanes = out;
+}
+
+template <size_t Size, size_t Stride>
+inline void BitonicMerge(Lanes& lanes) {
+  BitonicStage<Size, Stride>(lanes);
+  if constexpr (Stride > 1) {
+    BitonicMerge<Size, Stride / 2>(lanes);
+  }
+}
+
+template <size_t Size>
+inline void BitonicSort(Lanes& lanes) {
+  BitonicMerge<Size, Size / 2>(lanes);
+  if constexpr (Size < kChannelNum) {
+    BitonicSort<Size * 2>(lanes);
+  }
+}
+
+}  // namespace common_mode_detail
+
+// Sorts 64 lanes ascending with a bitonic network: a fixed sequence of 21
+// compare-exchange stages with no data-dependent branches.
+inline void bitonic_sort64(std::array<int16_t, kChannelNum>& lanes) {
+  static_assert(kChannelNum == 64, "the network is laid out for 64 lanes");
+  common_mode_detail::BitonicSort<2>(lanes);
+}
+
+// Per-event, per-ASIC software common mode over the channels flagged in
+// chflag. Unflagged lanes are filled with INT16_MAX so they sort past the
+// flagged ones, and the estimate reads the first `flagged` sorted lanes:
+//
+//   median  the middle value, or the mean of the two middle values
+//   mean    the mean of the central half (lowest and highest quarter dropped)
+//
+// With a pedestal table the lanes hold ADC - pedestal[ch], so the result is
+// on the scale of the hardware CMN, and hit channels are left out: lanes more
+// than hit_threshold ADC above the median of all flagged lanes are signal,
+// not baseline, and the estimate reads only the sorted lanes below that cut.
+// Without a table the channels' own pedestals spread wider than any useful
+// cut, so every flagged channel is used. Values are kept in half-ADC units so
+// pedestals ending in .5 stay exact in 16-bit lanes.
+class CommonModeEstimator {
+ public:
+  static constexpr int kDefaultHitThreshold = 20;
+
+  explicit CommonModeEstimator(CommonModeMethod method = CommonModeMethod::kHardware,
+                               const ChannelTable* pedestal = nullptr,
+                               int hit_threshold = kDefaultHitThreshold)
+      : method_(method), hit_threshold_(pedestal != nullptr ? hit_threshold : 0) {
+    if (pedestal != nullptr) {
+      for (size_t asic = 0; asic < kAsicNum; ++asic) {
+        for (size_t channel = 0; channel < kChannelNum; ++channel) {
+          offset_[asic][channel] =  // NOLINT
+              static_cast<int16_t>(std::lround(2.0 * (*pedestal)[asic][channel]));  // NOLINT
+        }
+      }
+    }
+  }
+
+  [[nodiscard]] auto Method() const -> CommonModeMethod { return method_; }
+
+  // Everything that changes the estimate, for checkpoint hashes.
+  [[nodiscard]] auto Describe() const -> std::string {
+    std::string description = std::string("common_mode=") + common_mode_name(method_) + ";";
+    if (hit_threshold_ > 0) {
+      description += "hit_threshold=" + std::to_string(hit_threshold_) + ";";
+    }
+    return description;
+  }
+
+  // The hardware CMN for kHardware, or when no channel of the ASIC is flagged.
+  [[nodiscard]] auto Estimate(const cdtedsd::ASICData<kChannelNum>& data, size_t asic) const
+      -> float {
+    if (method_ == CommonModeMethod::kHardware) {
+      return static_cast<float>(data.cmn);
+    }
+    const uint64_t flags = data.chflag.to_ullong();
+    const auto& offset = offset_[asic];  // NOLINT
+    std::array<int16_t, kChannelNum> lanes{};
+    for (size_t channel = 0; channel < kChannelNum; ++channel) {
+      const auto value =
+          static_cast<int16_t>(2 * data.adc_data[channel] - offset[channel]);  // NOLINT
+      lanes[channel] = ((flags >> channel) & 1U) != 0 ? value : kEmptyLane;  // NOLINT
+    }
+    const auto flagged = static_cast<size_t>(data.chflag.count());
+    if (flagged == 0) {
+      return static_cast<float>(data.cmn);
+    }
+    bitonic_sort64(lanes);
+    const size_t unhit = hit_threshold_ > 0 ? Unhit(lanes, flagged) : flagged;
+
+    if (method_ == CommonModeMethod::kMedian) {
+      const int sum = lanes[(unhit - 1) / 2] + lanes[unhit / 2];  // NOLINT
+      return static_cast<float>(sum) / 4.0F;
+    }
+    const size_t trim = unhit / 4;
+    int sum = 0;
+    for (size_t i = trim; i < unhit - trim; ++i) {
+      sum += lanes[i];  // NOLINT
+    }
+    return static_cast<float>(sum) / (2.0F * static_cast<float>(unhit - 2 * trim));
+  }
+
+ private:
+  static constexpr int16_t kEmptyLane = std::numeric_limits<int16_t>::max();
+
+  // Sorted lanes at or below the hit cut; never fewer than half of flagged,
+  // since the cut lies above their median.
+  [[nodiscard]] auto Unhit(const std::array<int16_t, kChannelNum>& lanes, size_t flagged) const
+      -> size_t {
+    const int median2 = lanes[(flagged - 1) / 2] + lanes[flagged / 2];  // NOLINT
+    const int cut2 = median2 + 4 * hit_threshold_;  // both in quarter-ADC units
+    const auto* end = lanes.data() + flagged;         // NOLINT
+    return static_cast<size_t>(
+        std::upper_bound(lanes.data(), end, cut2,
+                         [](int cut, int16_t lane) { return cut < 2 * lane; }) -
+        lanes.data());
+  }
+
+  CommonModeMethod method_ = CommonModeMethod::kHardware;
+  int hit_threshold_ = 0;  // ADC; 0 without a pedestal table
+  std::array<std::array<int16_t, kChannelNum>, kAsicNum> offset_{};
+};
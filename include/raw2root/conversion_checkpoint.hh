@@ -0,0 +1,140 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <vector>
+
+// Progress of a raw2root conversion, stored next to the .root output so a
+// later run can append only the frames that were added since.
+struct ConversionCheckpoint {
+  static constexpr uint32_t kVersion = 1;
+  // Bytes of the raw file hashed to detect a replaced (not appended) input.
+  static constexpr size_t kFingerprintBytes = 4096;
+
+  uint64_t byte_offset = 0;
+  uint64_t frames = 0;
+  uint64_t events = 0;
+  uint64_t histogram_entries = 0;
+  // Entries written to the events tree; differs from events when filtering.
+  uint64_t tree_entries = 0;
+  uint64_t fingerprint = 0;
+  // Hash of the event selection and calibration tables the tree was written
+  // with (0 for neither).
+  uint64_t selection = 0;
+};
+
+inline auto checkpoint_path_for(const std::string& root_file_name) -> std::string {
+  return root_file_name + ".ckpt";
+}
+
+inline constexpr uint64_t kFnvOffsetBasis = 0xCBF29CE484222325ULL;
+
+inline auto fnv1a(const char* data, size_t size, uint64_t hash = kFnvOffsetBasis) -> uint64_t {
+  for (size_t i = 0; i < size; ++i) {
+    hash ^= static_cast<uint8_t>(data[i]);  // NOLINT
+    hash *= 0x100000001B3ULL;
+  }
+  return hash;
+}
+
+inline auto selection_hash(const std::string& description) -> uint64_t {
+  return description.empty() ? 0 : fnv1a(description.data(), description.size());
+}
+
+// FNV-1a over the leading bytes of the raw file. Appending data never changes
+// it once the file is longer than kFingerprintBytes.
+inline auto raw_file_fingerprint(const std::string& input_file, uint64_t limit)
+    -> std::optional<uint64_t> {
+  std::ifstream file(input_file, std::ios::binary);
+  if (!file.is_open()) {
+    return std::nullopt;
+  }
+  std::vector<char> buffer(
+      static_cast<size_t>(std::min<uint64_t>(limit, ConversionCheckpoint::kFingerprintBytes)));
+  file.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+  if (static_cast<size_t>(file.gcount()) != buffer.size()) {
+    return std::nullopt;
+  }
+  return fnv1a(buffer.data(), buffer.size());
+}
+
+inline auto load_checkpoint(const std::string& path) -> std::optional<ConversionCheckpoint> {
+  std::ifstream file(path);
+  if (!file.is_open()) {
+    return std::nullopt;
+  }
+  ConversionCheckpoint checkpoint{};
+  uint32_t version = 0;
+  bool has_offset = false;
+  bool has_tree_entries = false;
+  std::string key;
+  uint64_t value = 0;
+  while (file >> key >> value) {
+    if (key == "version") {
+      version = static_cast<uint32_t>(value);
+    } else if (key == "byte_offset") {
+      checkpoint.byte_offset = value;
+      has_offset = true;
+    } else if (key == "frames") {
+      checkpoint.frames = value;
+    } else if (key == "events") {
+      checkpoint.events = value;
+    } else if (key == "histogram_entries") {
+      checkpoint.histogram_entries = value;
+    } else if (key == "tree_entries") {
+      checkpoint.tree_entries = value;
+      has_tree_entries = true;
+    } else if (key == "fingerprint") {
+      checkpoint.fingerprint = value;
+    } else if (key == "selection") {
+      checkpoint.selection = value;
+    }
+  }
+  if (version != ConversionCheckpoint::kVersion || !has_offset) {
+    return std::nullopt;
+  }
+  if (!has_tree_entries) {
+    // Written before event filtering existed: every event went to the tree.
+    checkpoint.tree_entries = checkpoint.events;
+  }
+  return checkpoint;
+}
+
+// Written to a temporary file and renamed so an interrupted run never leaves
+// a truncated checkpoint behind.
+inline auto save_checkpoint(const std::string& path, const ConversionCheckpoint& checkpoint)
+    -> bool {
+  const std::string temporary = path + ".tmp";
+  {
+    std::ofstream file(temporary, std::ios::trunc);
+    if (!file.is_open()) {
+      return false;
+    }
+    file << "version " << ConversionCheckpoint::kVersion << "\n"
+         << "byte_offset " << checkpoint.byte_offset << "\n"
+         << "frames " << checkpoint.frames << "\n"
+         << "events " << checkpoint.events << "\n"
+         << "histogram_entries " << checkpoint.histogram_entries << "\n"
+         << "tree_entries " << checkpoint.tree_entries << "\n"
+         << "fingerprint " << checkpoint.fingerprint << "\n"
+         << "selection " << checkpoint.selection << "\n";
+    if (!file.good()) {
+      return false;
+    }
+  }
+  std::error_code error;
+  std::filesystem::rename(temporary, path, error);
+  return !error;
+}
+
+inline void remove_checkpoint(const std::string& path) {
+  std::error_code error;
+  std::filesystem::remove(path, error);
+}
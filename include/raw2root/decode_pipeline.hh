@@ -0,0 +1,296 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <csignal>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "detector_constants.hh"
+#include "frame_analyzer.hh"
+#include "raw_data_file.hh"
+#include "stage_profile.hh"
+
+using DecodedEvent = cdtedsd::EventData<kAsicNum, kChannelNum>;
+
+// Consumer of decoded events. Every registered sink sees the same events from
+// one read/decode pass, in file order, always on the same thread. Sinks are
+// independent: each one receives a whole frame's events before the next sink.
+class EventSink {
+ public:
+  EventSink() = default;
+  EventSink(const EventSink&) = delete;
+  EventSink(EventSink&&) = delete;
+  auto operator=(const EventSink&) -> EventSink& = delete;
+  auto operator=(EventSink&&) -> EventSink& = delete;
+  virtual ~EventSink() = default;
+
+  // Invalid (corrupted/misaligned) events are delivered too, with
+  // event.valid == false, so each sink decides how to report them.
+  virtual void OnEvent(const DecodedEvent& event, size_t frame_index) = 0;
+  // Called after every event of a frame has been delivered.
+  virtual void OnFrameEnd(size_t /*frame_index*/) {}
+  // A sink that needs no more data; the pass ends once every sink is done.
+  [[nodiscard]] virtual auto Done() const -> bool { return false; }
+};
+
+struct PipelineFrameInfo {
+  size_t frame_index = 0;
+  size_t events = 0;
+  size_t valid_events = 0;
+  // Raw file offset just past this frame, i.e. where a resumed pass starts.
+  uint64_t end_offset = 0;
+};
+
+struct PipelineResult {
+  size_t frames = 0;
+  size_t events = 0;
+  size_t invalid_events = 0;
+  bool aborted = false;
+};
+
+// Reads a RawDataFile once, decodes it with FrameAnalyzer and fans every
+// event out to the registered sinks.
+//
+// In threaded mode reading and decoding run on a worker thread that hands
+// whole decoded frames to the calling thread, which runs the sinks. Sinks are
+// therefore never called concurrently with each other (ROOT objects stay
+// single-threaded), but file I/O and decoding overlap with sink work.
+class DecodePipeline {
+ public:
+  explicit DecodePipeline(RawDataFile& raw, size_t first_frame_index = 0,
+                          const volatile std::sig_atomic_t* abort_flag = nullptr)
+      : raw_(raw),
+        first_frame_index_(first_frame_index),
+        abort_flag_(abort_flag),
+        last_offset_(raw.GetPosition()) {}
+
+  // times, when given, accumulates the time spent in this sink.
+  void AddSink(EventSink& sink, StageTimes* times = nullptr) {
+    sinks_.push_back({&sink, times});
+  }
+  void SetThreaded(bool threaded) { threaded_ = threaded; }
+  // Accumulates RawDataFile reads and FrameAnalyzer decoding; null disables.
+  void SetProfile(StageTimes* read, StageTimes* decode) {
+    read_times_ = read;
+    decode_times_ = decode;
+  }
+
+  // on_frame(const PipelineFrameInfo&) runs after the sinks consumed a frame.
+  template <typename OnFrame>
+  auto Run(OnFrame&& on_frame) -> PipelineResult {
+    return threaded_ ? RunThreaded(on_frame) : RunInline(on_frame);
+  }
+
+  auto Run() -> PipelineResult {
+    return Run([](const PipelineFrameInfo& /*info*/) {});
+  }
+
+ private:
+  struct FrameBatch {
+    PipelineFrameInfo info{};
+    uint64_t bytes = 0;
+    std::vector<DecodedEvent> events;
+  };
+
+  struct SinkEntry {
+    EventSink* sink = nullptr;
+    StageTimes* times = nullptr;
+  };
+
+  // Frames decoded ahead of the sinks; bounds memory to a few frames.
+  static constexpr size_t kQueueDepth = 4;
+
+  [[nodiscard]] auto Aborted() const -> bool { return abort_flag_ && *abort_flag_ != 0; }
+
+  [[nodiscard]] auto AllSinksDone() const -> bool {
+    if (sinks_.empty()) {
+      return false;
+    }
+    for (const auto& entry : sinks_) {
+      if (!entry.sink->Done()) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  auto DecodeNextFrame(FrameBatch& batch, size_t frame_index) -> bool {
+    std::optional<StageClock> read_clock;
+    if (read_times_ != nullptr) {
+      read_clock.emplace();
+    }
+    if (!raw_.GetNextFrame()) {
+      return false;
+    }
+    const uint64_t end_offset = raw_.GetPosition();
+    batch.bytes = end_offset - std::min(end_offset, last_offset_);
+    last_offset_ = end_offset;
+    if (read_clock) {
+      read_clock->Stop(*read_times_, batch.bytes);
+    }
+
+    std::optional<StageClock> decode_clock;
+    if (decode_times_ != nullptr) {
+      decode_clock.emplace();
+    }
+    const auto& frame = raw_.GetFrame();
+    analyzer_.Initialize(reinterpret_cast<const uint8_t*>(frame.data()),  // NOLINT
+                         frame.size());
+    batch.events.clear();
+    batch.events.emplace_back();
+    while (analyzer_.UnpackNextEvent(batch.events.back())) {
+      batch.events.emplace_back();
+    }
+    batch.events.pop_back();
+    batch.info.frame_index = frame_index;
+    batch.info.events = batch.events.size();
+    batch.info.valid_events = static_cast<size_t>(
+        std::count_if(batch.events.begin(), batch.events.end(),
+                      [](const DecodedEvent& event) { return event.valid; }));
+    batch.info.end_offset = end_offset;
+    if (decode_clock) {
+      decode_clock->Stop(*decode_times_, batch.bytes, batch.info.events);
+    }
+    return true;
+  }
+
+  template <typename OnFrame>
+  void Dispatch(const FrameBatch& batch, PipelineResult& result, OnFrame& on_frame) {
+    for (const auto& entry : sinks_) {
+      std::optional<StageClock> clock;
+      if (entry.times != nullptr) {
+        clock.emplace();
+      }
+      for (const auto& event : batch.events) {
+        entry.sink->OnEvent(event, batch.info.frame_index);
+      }
+      entry.sink->OnFrameEnd(batch.info.frame_index);
+      if (clock) {
+        clock->Stop(*entry.times, batch.bytes, batch.info.events);
+      }
+    }
+    result.events += batch.info.valid_events;
+    result.invalid_events += batch.info.events - batch.info.valid_events;
+    ++result.frames;
+    on_frame(batch.info);
+  }
+
+  template <typename OnFrame>
+  auto RunInline(OnFrame& on_frame) -> PipelineResult {
+    PipelineResult result{};
+    FrameBatch batch{};
+    size_t frame_index = first_frame_index_;
+    while (!Aborted() && !AllSinksDone() && DecodeNextFrame(batch, frame_index)) {
+      Dispatch(batch, result, on_frame);
+      ++frame_index;
+    }
+    result.aborted = Aborted();
+    return result;
+  }
+
+  template <typename OnFrame>
+  auto RunThreaded(OnFrame& on_frame) -> PipelineResult {
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<FrameBatch> ready;
+    std::vector<FrameBatch> spare(kQueueDepth);
+    bool producer_finished = false;
+    bool consumer_stopped = false;
+    std::exception_ptr producer_error;
+
+    std::thread producer([&]() -> void {
+      try {
+        size_t frame_index = first_frame_index_;
+        while (!Aborted()) {
+          FrameBatch batch{};
+          {
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [&]() { return !spare.empty() || consumer_stopped; });
+            if (consumer_stopped) {
+              break;
+            }
+            batch = std::move(spare.back());
+            spare.pop_back();
+          }
+          if (!DecodeNextFrame(batch, frame_index)) {
+            break;
+          }
+          ++frame_index;
+          {
+            std::lock_guard<std::mutex> lock(mutex);
+            ready.push_back(std::move(batch));
+          }
+          changed.notify_all();
+        }
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(mutex);
+        producer_error = std::current_exception();
+      }
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        producer_finished = true;
+      }
+      changed.notify_all();
+    });
+
+    PipelineResult result{};
+    auto stop_producer = [&]() -> void {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        consumer_stopped = true;
+      }
+      changed.notify_all();
+      producer.join();
+    };
+    try {
+      while (true) {
+        FrameBatch batch{};
+        {
+          std::unique_lock<std::mutex> lock(mutex);
+          changed.wait(lock, [&]() { return !ready.empty() || producer_finished; });
+          if (ready.empty()) {
+            break;
+          }
+          batch = std::move(ready.front());
+          ready.pop_front();
+        }
+        Dispatch(batch, result, on_frame);
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          spare.push_back(std::move(batch));
+        }
+        changed.notify_all();
+        if (AllSinksDone()) {
+          break;
+        }
+      }
+    } catch (...) {
+      stop_producer();
+      throw;
+    }
+    stop_producer();
+    if (producer_error) {
+      std::rethrow_exception(producer_error);
+    }
+    result.aborted = Aborted();
+    return result;
+  }
+
+  RawDataFile& raw_;
+  cdtedsd::FrameAnalyzer<kAsicNum, kChannelNum> analyzer_{};
+  std::vector<SinkEntry> sinks_;
+  StageTimes* read_times_ = nullptr;
+  StageTimes* decode_times_ = nullptr;
+  size_t first_frame_index_ = 0;
+  const volatile std::sig_atomic_t* abort_flag_ = nullptr;
+  bool threaded_ = false;
+  // Offset before the next frame, used to charge each frame's bytes.
+  uint64_t last_offset_ = 0;
+};
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string_view>
+
+// Event-counter and ti continuity of one detector's data frames, checked
+// from two event headers per frame: the first event, which starts the
+// frame, and the last one. Events are 4-byte aligned and every event after
+// the first directly follows the previous event's footer, so the last event
+// is found by scanning back over the padding for a header preceded by a
+// footer, without decoding any ASIC data. That keeps the check cheap enough
+// to run on every frame a readout writes.
+//
+// Not thread-safe: AddFrame and GetStats belong to one thread.
+class EventContinuity {
+ public:
+  // ti and event_counter of the first and last event of a frame.
+  struct Edges {
+    uint32_t first_ti = 0;
+    uint32_t first_counter = 0;
+    uint32_t last_ti = 0;
+    uint32_t last_counter = 0;
+  };
+
+  struct Stats {
+    uint64_t frames = 0;    // frames that start with an event header
+    uint64_t unparsed = 0;  // frames that do not
+    // Jumps in event_counter between frames, and the events they skip.
+    uint64_t gaps = 0;
+    uint64_t lost_events = 0;
+    // Frames whose first event does not follow the last one seen.
+    uint64_t out_of_order = 0;
+    // Times the counter went back for kRestartFrames frames in a row and was
+    // followed from there; those frames are not counted as out of order.
+    uint64_t restarts = 0;
+    // Steps in ti between frames longer than the ti span of the frames on
+    // either side, and the largest step, in ticks.
+    uint64_t time_gaps = 0;
+    uint64_t max_ti_step = 0;
+  };
+
+  static constexpr uint32_t kRestartFrames = 4;
+  static constexpr size_t kEventHeaderBytes = 24;
+
+  // The edges of one frame, or nullopt when it does not start with an event.
+  static auto FindEdges(std::string_view frame) -> std::optional<Edges> {
+    const auto* data = reinterpret_cast<const uint8_t*>(frame.data());  // NOLINT
+    if (frame.size() < kEventHeaderBytes || !WordIs(data, kEventHeader)) {
+      return std::nullopt;
+    }
+    Edges edges;
+    edges.first_ti = ReadWord(data + 4);        // NOLINT
+    edges.first_counter = ReadWord(data + 16);  // NOLINT
+    edges.last_ti = edges.first_ti;
+    edges.last_counter = edges.first_counter;
+    for (size_t offset = (frame.size() - kEventHeaderBytes) & ~size_t{3}; offset >= 4;
+         offset -= 4) {
+      if (WordIs(data + offset, kEventHeader) && WordIs(data + offset - 4, kEventFooter)) {
+        edges.last_ti = ReadWord(data + offset + 4);        // NOLINT
+        edges.last_counter = ReadWord(data + offset + 16);  // NOLINT
+        break;
+      }
+    }
+    return edges;
+  }
+
+  void AddFrame(std::string_view frame) {
+    const auto edges = FindEdges(frame);
+    if (!edges) {
+      ++stats_.unparsed;
+      return;
+    }
+    ++stats_.frames;
+    if (!previous_) {
+      previous_ = edges;
+      return;
+    }
+    // Counters and ti wrap at 32 bits; a step of half the range or more, or
+    // none at all, means the frame is behind the previous one.
+    const uint32_t step = edges->first_counter - previous_->last_counter;
+    if (step == 0 || step >= kBehind) {
+      if (++behind_ < kRestartFrames) {
+        ++stats_.out_of_order;
+        return;
+      }
+      stats_.out_of_order -= kRestartFrames - 1;
+      ++stats_.restarts;
+      behind_ = 0;
+      previous_ = edges;
+      return;
+    }
+    behind_ = 0;
+    if (step > 1) {
+      ++stats_.gaps;
+      stats_.lost_events += step - 1;
+    }
+    const uint32_t ti_step = edges->first_ti - previous_->last_ti;
+    if (ti_step < kBehind) {
+      stats_.max_ti_step = std::max<uint64_t>(stats_.max_ti_step, ti_step);
+      const uint32_t span = std::max(previous_->last_ti - previous_->first_ti,
+                                     edges->last_ti - edges->first_ti);
+      if (span > 0 && ti_step > span) {
+        ++stats_.time_gaps;
+      }
+    }
+    previous_ = edges;
+  }
+
+  [[nodiscard]] auto GetStats() const -> const Stats& { return stats_; }
+
+ private:
+  static constexpr std::array<uint8_t, 4> kEventHeader = {0x3C, 0x3C, 0x00, 0x00};
+  static constexpr std::array<uint8_t, 4> kEventFooter = {0x00, 0x00, 0x77, 0x77};
+  static constexpr uint32_t kBehind = 0x80000000U;
+
+  static auto WordIs(const uint8_t* data, const std::array<uint8_t, 4>& word) -> bool {
+    return std::memcmp(data, word.data(), word.size()) == 0;
+  }
+
+  static auto ReadWord(const uint8_t* data) -> uint32_t {
+    uint32_t value = 0;
+    for (size_t i = 0; i < 4; ++i) {
+      value = (value << 8) | data[i];  // NOLINT
+    }
+    return value;
+  }
+
+  Stats stats_;
+  std::optional<Edges> previous_;
+  uint32_t behind_ = 0;
+};
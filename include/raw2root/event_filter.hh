@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <sstream>
+#include <string>
+
+#include "channel_table.hh"
+#include "decode_pipeline.hh"
+
+// Event selection applied before an event is written to the tree. Every
+// criterion is optional; an empty filter keeps every valid event.
+class EventFilter {
+ public:
+  void DropPseudo() { drop_pseudo_ = true; }
+  // Keeps events whose trigger hit pattern shares at least one bit with mask.
+  void RequireTrigger(uint32_t mask) { trigger_mask_ = mask; }
+  // Keeps events with at least one hit channel at or above its ADC-CMN threshold.
+  void RequireHit(const ChannelTable& thresholds) { thresholds_ = thresholds; }
+  void SelectTi(std::optional<uint32_t> min, std::optional<uint32_t> max) {
+    ti_min_ = min;
+    ti_max_ = max;
+  }
+
+  [[nodiscard]] auto Empty() const -> bool {
+    return !drop_pseudo_ && !trigger_mask_ && !thresholds_ && !ti_min_ && !ti_max_;
+  }
+
+  [[nodiscard]] auto Accept(const DecodedEvent& event) const -> bool {
+    if (!event.valid) {
+      return false;
+    }
+    if (drop_pseudo_ && event.is_pseudo_event) {
+      return false;
+    }
+    if (trigger_mask_ && (event.flag_trig_pat & *trigger_mask_) == 0) {
+      return false;
+    }
+    if ((ti_min_ && event.ti < *ti_min_) || (ti_max_ && event.ti > *ti_max_)) {
+      return false;
+    }
+    return !thresholds_ || HasHit(event);
+  }
+
+  // Canonical text of the selection, stored with conversion checkpoints so a
+  // resumed run never mixes two selections in one tree.
+  [[nodiscard]] auto Describe() const -> std::string {
+    std::ostringstream out;
+    if (drop_pseudo_) {
+      out << "drop_pseudo;";
+    }
+    if (trigger_mask_) {
+      out << "trigger=" << *trigger_mask_ << ';';
+    }
+    if (ti_min_ || ti_max_) {
+      out << "ti=" << (ti_min_ ? std::to_string(*ti_min_) : "") << ':'
+          << (ti_max_ ? std::to_string(*ti_max_) : "") << ';';
+    }
+    if (thresholds_) {
+      out << "threshold=";
+      for (const auto& asic : *thresholds_) {
+        for (const double value : asic) {
+          out << value << ',';
+        }
+      }
+      out << ';';
+    }
+    return out.str();
+  }
+
+ private:
+  [[nodiscard]] auto HasHit(const DecodedEvent& event) const -> bool {
+    for (size_t asic = 0; asic < kAsicNum; ++asic) {
+      const auto& data = event.asic_data[asic];       // NOLINT
+      const auto& thresholds = (*thresholds_)[asic];  // NOLINT
+      for (size_t channel = 0; channel < kChannelNum; ++channel) {
+        if (data.chflag.test(channel) &&
+            data.adc_data[channel] - data.cmn >= thresholds[channel]) {  // NOLINT
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+
+  bool drop_pseudo_ = false;
+  std::optional<uint32_t> trigger_mask_;
+  std::optional<ChannelTable> thresholds_;
+  std::optional<uint32_t> ti_min_;
+  std::optional<uint32_t> ti_max_;
+};
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <string_view>
+
+// Decoder of the 1024-byte HK frames streamed next to the data frames
+// (DataStreamType_HKData) and stored in the readout's _hk files. An HK frame
+// is the register image of one detector: register N of CdTeDSDAddress
+// (proto/rmap.proto) is the big-endian 32-bit word at byte 4 * N, as rmapRead
+// returns it. kFields is the only description of the layout; hk2col and the
+// readout status both decode through it, so a layout change is a change to
+// this table alone.
+namespace hk_frame {
+
+constexpr size_t kFrameBytes = 1024;
+
+enum class FieldType : uint8_t {
+  kU32,  // one register
+  kU64,  // an upper/lower register pair, upper first
+};
+
+struct Field {
+  std::string_view name;
+  size_t offset;  // bytes from the start of the frame
+  FieldType type;
+  // Physical value = raw * scale, in unit; "raw" marks an uncalibrated ADC.
+  double scale;
+  std::string_view unit;
+  bool status;  // shown by readout status
+};
+
+constexpr auto register_offset(uint32_t address) -> size_t { return size_t{4} * address; }
+
+constexpr auto field_bytes(FieldType type) -> size_t { return type == FieldType::kU64 ? 8 : 4; }
+
+constexpr std::array<Field, 12> kFields = {{
+    Field{"ti", register_offset(29), FieldType::kU64, 1.0, "tick", true},
+    Field{"timecode", register_offset(32), FieldType::kU32, 1.0, "", false},
+    Field{"va_status", register_offset(0), FieldType::kU32, 1.0, "", false},
+    Field{"module_status", register_offset(1), FieldType::kU32, 1.0, "", true},
+    Field{"live_time", register_offset(17), FieldType::kU32, 1.0, "tick", true},
+    Field{"dead_time", register_offset(18), FieldType::kU32, 1.0, "tick", true},
+    Field{"hv", register_offset(23), FieldType::kU32, 1.0, "", false},
+    Field{"hv_value", register_offset(24), FieldType::kU32, 1.0, "raw", true},
+    Field{"dram_write_pointer", register_offset(27), FieldType::kU32, 1.0, "", false},
+    Field{"pseudo_counter", register_offset(39), FieldType::kU32, 1.0, "", false},
+    Field{"temperature", register_offset(44), FieldType::kU32, 1.0, "raw", true},
+    Field{"humidity", register_offset(45), FieldType::kU32, 1.0, "raw", true},
+}};
+
+constexpr auto fields_fit() -> bool {
+  for (const auto& field : kFields) {
+    if (field.offset + field_bytes(field.type) > kFrameBytes) {
+      return false;
+    }
+  }
+  return true;
+}
+static_assert(fields_fit(), "every HK field must lie inside the frame");
+
+// Raw values of every field of one frame, in kFields order.
+using Values = std::array<uint64_t, kFields.size()>;
+
+// Index of the named field in kFields, or kFields.size().
+constexpr auto field_index(std::string_view name) -> size_t {
+  for (size_t i = 0; i < kFields.size(); ++i) {
+    if (kFields[i].name == name) {
+      return i;
+    }
+  }
+  return kFields.size();
+}
+
+// frame must hold kFrameBytes bytes.
+inline auto read_field(const char* frame, const Field& field) -> uint64_t {
+  std::array<unsigned char, 8> bytes{};
+  const auto size = field_bytes(field.type);
+  std::memcpy(bytes.data(), frame + field.offset, size);  // NOLINT
+  uint64_t value = 0;
+  for (size_t i = 0; i < size; ++i) {
+    value = (value << 8) | bytes[i];  // NOLINT
+  }
+  return value;
+}
+
+inline auto decode(const char* frame) -> Values {
+  Values values{};
+  for (size_t i = 0; i < kFields.size(); ++i) {
+    values[i] = read_field(frame, kFields[i]);  // NOLINT
+  }
+  return values;
+}
+
+inline auto physical(const Field& field, uint64_t raw) -> double {
+  return static_cast<double>(raw) * field.scale;
+}
+
+// Unscaled fields are written as integers, so a 64-bit ti keeps every digit.
+inline void write_value(std::ostream& output, const Field& field, uint64_t raw) {
+  if (field.scale == 1.0) {
+    output << raw;
+  } else {
+    output << physical(field, raw);
+  }
+}
+
+}  // namespace hk_frame
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "channel_table.hh"
+#include "decode_pipeline.hh"
+#include "pedestal_sink.hh"
+
+// Pedestal tables accumulated from frames as they arrive during a readout,
+// one PedestalSink per detector. AddFrame runs on a FrameTap worker; Summary
+// and Table may be called from any thread.
+//
+// Convergence is tracked by recomputing every channel median each
+// kCheckInterval valid events: the largest change since the previous check
+// is the median shift reported by Summary. Once it stays at zero, more data
+// will not change the calibrated register.
+class OnlinePedestal {
+ public:
+  static constexpr size_t kCheckInterval = 2048;
+
+  struct DetectorSummary {
+    uint8_t address = 0;
+    uint64_t frames = 0;
+    uint64_t events = 0;
+    // Frames whose decoding stopped on a corrupt event; the events before it
+    // are kept.
+    uint64_t decode_errors = 0;
+    uint64_t min_samples = 0;
+    uint64_t max_samples = 0;
+    size_t empty_channels = 0;
+    size_t checks = 0;
+    std::optional<double> median_shift;
+  };
+
+  explicit OnlinePedestal(const std::vector<uint8_t>& addresses) {
+    for (const auto address : addresses) {
+      detectors_.emplace(address, std::make_unique<Detector>());
+    }
+  }
+
+  void AddFrame(uint8_t address, std::string_view frame) {
+    const auto found = detectors_.find(address);
+    if (found == detectors_.end()) {
+      return;
+    }
+    auto& detector = *found->second;
+    // Decoding only touches this detector's analyzer and scratch events, and
+    // only the tap worker calls AddFrame, so the lock covers the sink alone.
+    detector.analyzer.Initialize(reinterpret_cast<const uint8_t*>(frame.data()),  // NOLINT
+                                 frame.size());
+    detector.events.clear();
+    detector.events.emplace_back();
+    // A corrupt frame can make the analyzer throw, e.g. on an event header in
+    // the last bytes of the frame. This runs on the tap worker, where an
+    // escaping exception would terminate the shell mid-acquisition.
+    bool failed = false;
+    try {
+      while (detector.analyzer.UnpackNextEvent(detector.events.back())) {
+        detector.events.emplace_back();
+      }
+    } catch (const std::exception&) {
+      failed = true;
+    }
+    detector.events.pop_back();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& event : detector.events) {
+      detector.sink.OnEvent(event, detector.frames);
+    }
+    ++detector.frames;
+    detector.decode_errors += failed ? 1 : 0;
+    if (detector.sink.EventCount() >= detector.next_check) {
+      Check(detector);
+      detector.next_check = detector.sink.EventCount() + kCheckInterval;
+    }
+  }
+
+  [[nodiscard]] auto Summary() const -> std::vector<DetectorSummary> {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<DetectorSummary> summaries;
+    for (const auto& [address, detector] : detectors_) {
+      DetectorSummary summary;
+      summary.address = address;
+      summary.frames = detector->frames;
+      summary.events = detector->sink.EventCount();
+      summary.decode_errors = detector->decode_errors;
+      summary.min_samples = std::numeric_limits<uint64_t>::max();
+      for (size_t asic = 0; asic < kAsicNum; ++asic) {
+        for (size_t channel = 0; channel < kChannelNum; ++channel) {
+          const uint64_t samples = detector->sink.Samples(asic, channel);
+          summary.min_samples = std::min(summary.min_samples, samples);
+          summary.max_samples = std::max(summary.max_samples, samples);
+          summary.empty_channels += samples == 0 ? 1 : 0;
+        }
+      }
+      summary.checks = detector->checks;
+      summary.median_shift = detector->median_shift;
+      summaries.push_back(summary);
+    }
+    return summaries;
+  }
+
+  // The table for one detector, or nullopt while any channel has no sample.
+  [[nodiscard]] auto Table(uint8_t address) const -> std::optional<ChannelTable> {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto found = detectors_.find(address);
+    if (found == detectors_.end() || found->second->sink.EventCount() == 0) {
+      return std::nullopt;
+    }
+    try {
+      return found->second->sink.Table();
+    } catch (const std::runtime_error&) {
+      return std::nullopt;
+    }
+  }
+
+ private:
+  struct Detector {
+    cdtedsd::FrameAnalyzer<kAsicNum, kChannelNum> analyzer{};
+    std::vector<DecodedEvent> events;
+    PedestalSink sink;
+    uint64_t frames = 0;
+    uint64_t decode_errors = 0;
+    size_t next_check = kCheckInterval;
+    size_t checks = 0;
+    std::vector<std::optional<double>> medians;
+    std::optional<double> median_shift;
+  };
+
+  static void Check(Detector& detector) {
+    std::vector<std::optional<double>> medians;
+    medians.reserve(kAsicNum * kChannelNum);
+    for (size_t asic = 0; asic < kAsicNum; ++asic) {
+      for (size_t channel = 0; channel < kChannelNum; ++channel) {
+        medians.push_back(detector.sink.ChannelMedian(asic, channel));
+      }
+    }
+    if (!detector.medians.empty()) {
+      double shift = 0.0;
+      for (size_t i = 0; i < medians.size(); ++i) {
+        if (medians[i] && detector.medians[i]) {
+          shift = std::max(shift, std::fabs(*medians[i] - *detector.medians[i]));
+        } else if (medians[i].has_value() != detector.medians[i].has_value()) {
+          shift = std::numeric_limits<double>::infinity();
+        }
+      }
+      detector.median_shift = shift;
+    }
+    detector.medians = std::move(medians);
+    ++detector.checks;
+  }
+
+  mutable std::mutex mutex_;
+  std::map<uint8_t, std::unique_ptr<Detector>> detectors_;
+};
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <csignal>
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "channel_stats_sink.hh"
+#include "decode_pipeline.hh"
+#include "pedestal_sink.hh"
+#include "progress_bar.hh"
+#include "raw_data_file.hh"
+#include "run_files.hh"
+
+// All raw files of one detector; they feed a single pedestal table.
+struct DetectorPedestal {
+  std::string key;
+  std::vector<std::string> files;
+  std::unique_ptr<PedestalSink> pedestal;
+  std::string error;
+  // Set before compute_pedestals to characterize the channels in the same pass.
+  std::unique_ptr<ChannelStatsSink> stats;
+};
+
+inline void accumulate_detector_pedestal(DetectorPedestal& detector,
+                                         const volatile std::sig_atomic_t* abort_flag,
+                                         ProgressBar* progress) {
+  uint64_t detector_bytes = 0;
+  uint64_t read_bytes = 0;
+  for (const auto& file : detector.files) {
+    std::error_code error;
+    const auto size = std::filesystem::file_size(file, error);
+    detector_bytes += error ? 0 : static_cast<uint64_t>(size);
+  }
+  try {
+    for (const auto& file : detector.files) {
+      if (detector.pedestal->Done()) {
+        break;
+      }
+      RawDataFile raw(file, false, abort_flag);
+      DecodePipeline pipeline(raw, 0, abort_flag);
+      pipeline.AddSink(*detector.pedestal);
+      if (detector.stats) {
+        pipeline.AddSink(*detector.stats);
+      }
+      pipeline.SetThreaded(true);
+      uint64_t offset = 0;
+      const auto result = pipeline.Run([&](const PipelineFrameInfo& frame) -> void {
+        if (progress != nullptr) {
+          progress->Advance(frame.end_offset - offset, frame.valid_events);
+        }
+        read_bytes += frame.end_offset - offset;
+        offset = frame.end_offset;
+      });
+      if (result.aborted) {
+        throw std::runtime_error("Interrupted");
+      }
+    }
+    if (detector.pedestal->EventCount() == 0) {
+      throw std::runtime_error("No valid events");
+    }
+  } catch (const std::exception& error) {
+    detector.error = error.what();
+  }
+  // Files or tails left unread after --max-events still complete the detector.
+  if (progress != nullptr && detector_bytes > read_bytes) {
+    progress->Skip(detector_bytes - read_bytes);
+  }
+}
+
+// Accumulates every detector on up to `jobs` threads. Failures are recorded
+// per detector in DetectorPedestal::error rather than thrown.
+inline void compute_pedestals(std::vector<DetectorPedestal>& detectors, size_t max_events,
+                              size_t jobs,
+                              const CommonModeEstimator& common_mode = CommonModeEstimator(),
+                              const volatile std::sig_atomic_t* abort_flag = nullptr,
+                              ProgressBar* progress = nullptr) {
+  for (auto& detector : detectors) {
+    detector.pedestal = std::make_unique<PedestalSink>(max_events, common_mode);
+    detector.error.clear();
+  }
+  std::atomic<size_t> next{0};
+  std::vector<std::thread> workers;
+  const size_t worker_count = std::min(std::max<size_t>(jobs, 1), detectors.size());
+  for (size_t i = 0; i < worker_count; ++i) {
+    workers.emplace_back([&]() {
+      for (size_t index = next++; index < detectors.size(); index = next++) {
+        accumulate_detector_pedestal(detectors[index], abort_flag, progress);
+      }
+    });
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+}
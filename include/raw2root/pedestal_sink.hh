@@ -0,0 +1,124 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <ostream>
+#include <stdexcept>
+#include <vector>
+
+#include "channel_table.hh"
+#include "common_mode.hh"
+#include "decode_pipeline.hh"
+
+// Median ADC-CMN per channel over the first max_events valid events. CMN is
+// the hardware word unless a software common mode is selected, in which case
+// ADC-CMN is rounded to the nearest count.
+//
+// ADC and CMN are 10-bit values, so ADC-CMN lies in [-1023, 1023]. Each
+// channel keeps a 2048-bin count histogram instead of the samples; medians
+// are exact and memory stays flat however many events are accumulated.
+class PedestalSink : public EventSink {
+ public:
+  static constexpr size_t kUnlimited = std::numeric_limits<size_t>::max();
+  static constexpr size_t kBins = 2048;
+  static constexpr int kOffset = 1024;
+  // One channel's ADC-CMN counts, bin = value + kOffset.
+  using Histogram = std::array<uint64_t, kBins>;
+
+  explicit PedestalSink(size_t max_events = kUnlimited,
+                        const CommonModeEstimator& common_mode = CommonModeEstimator())
+      : max_events_(max_events), common_mode_(common_mode) {}
+
+  void OnEvent(const DecodedEvent& event, size_t /*frame_index*/) override {
+    if (!event.valid || Done()) {
+      return;
+    }
+    ++event_count_;
+    for (size_t asic = 0; asic < kAsicNum; ++asic) {
+      const auto& data = event.asic_data[asic];  // NOLINT
+      const float cmn = common_mode_.Estimate(data, asic);
+      for (size_t channel = 0; channel < kChannelNum; ++channel) {
+        if (data.chflag.test(channel)) {
+          const int bin = std::clamp(
+              static_cast<int>(std::lround(data.adc_data[channel] - cmn)) + kOffset, 0,  // NOLINT
+              static_cast<int>(kBins) - 1);
+          ++histograms_[asic * kChannelNum + channel][static_cast<size_t>(bin)];  // NOLINT
+        }
+      }
+    }
+  }
+
+  [[nodiscard]] auto Done() const -> bool override { return event_count_ >= max_events_; }
+  [[nodiscard]] auto EventCount() const -> size_t { return event_count_; }
+
+  // Samples accumulated so far for one channel.
+  [[nodiscard]] auto Samples(size_t asic, size_t channel) const -> uint64_t {
+    return Total(histograms_[asic * kChannelNum + channel]);  // NOLINT
+  }
+
+  // Median of one channel, or nullopt before its first sample.
+  [[nodiscard]] auto ChannelMedian(size_t asic, size_t channel) const -> std::optional<double> {
+    return Median(histograms_[asic * kChannelNum + channel]);  // NOLINT
+  }
+
+  [[nodiscard]] auto Table() const -> ChannelTable {
+    ChannelTable table{};
+    for (size_t asic = 0; asic < kAsicNum; ++asic) {
+      for (size_t channel = 0; channel < kChannelNum; ++channel) {
+        const auto median = ChannelMedian(asic, channel);
+        if (!median) {
+          throw std::runtime_error("No pedestal samples for one or more channels");
+        }
+        table[asic][channel] = *median;  // NOLINT
+      }
+    }
+    return table;
+  }
+
+  // Four lines (one per ASIC) of 64 medians, the layout load_channel_table reads.
+  void WriteTable(std::ostream& out) const { write_channel_table(out, Table()); }
+
+  static auto Total(const Histogram& histogram) -> uint64_t {
+    uint64_t total = 0;
+    for (const auto count : histogram) {
+      total += count;
+    }
+    return total;
+  }
+
+  // Same definition as before: the middle sample, or the mean of the two
+  // middle samples for an even count.
+  static auto Median(const Histogram& histogram) -> std::optional<double> {
+    const uint64_t total = Total(histogram);
+    if (total == 0) {
+      return std::nullopt;
+    }
+    const uint64_t lower_rank = (total - 1) / 2;
+    const uint64_t upper_rank = total / 2;
+    std::optional<int> lower;
+    uint64_t seen = 0;
+    for (size_t bin = 0; bin < kBins; ++bin) {
+      seen += histogram[bin];  // NOLINT
+      const int value = static_cast<int>(bin) - kOffset;
+      if (!lower && seen > lower_rank) {
+        lower = value;
+      }
+      if (seen > upper_rank) {
+        return (static_cast<double>(*lower) + value) / 2.0;
+      }
+    }
+    throw std::logic_error("Pedestal histogram median out of range");
+  }
+
+ private:
+  // Indexed asic * kChannelNum + channel; 4 MiB, so kept off the stack.
+  std::vector<Histogram> histograms_ = std::vector<Histogram>(kAsicNum * kChannelNum);
+  size_t max_events_ = kUnlimited;
+  CommonModeEstimator common_mode_;
+  size_t event_count_ = 0;
+};
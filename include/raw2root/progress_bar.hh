@@ -1,91 +1,179 @@
 #pragma once
 
+#include <unistd.h>
+
 #include <algorithm>
 #include <array>
+#include <atomic>
+#include <chrono>
 #include <cmath>
 #include <cstddef>
-#include <iomanip>
+#include <cstdint>
+#include <cstdio>
 #include <iostream>
-#include <sstream>
+#include <mutex>
 #include <string>
 
+// Progress over a known amount of input bytes, shared by every worker and
+// file of one run.
+//
+// Advance may be called from any thread after each frame. It only touches two
+// atomic counters unless a render is due; renders are rate limited by time
+// (at most renders_per_second), not by frame count, so the cost does not
+// depend on how fast frames arrive. Percentage, MB/s, events/s and ETA are
+// all derived from bytes consumed, which is exact for both frame formats.
+//
+// On a terminal the bar is redrawn in place; otherwise (logs, pipes) a plain
+// line is written every kLogInterval instead.
 class ProgressBar {
  public:
-  explicit ProgressBar(size_t total_frames, size_t interval = 100,
-                       std::size_t bar_width = 50)
-      : total_frames_(total_frames),
-        interval_(interval),
-        bar_width_(bar_width),
-        show_progress_(total_frames_ > 0),
-        display_total_frames_(show_progress_ ? total_frames_ : 1),
-        frame_counter_width_(
-            static_cast<int>(std::to_string(display_total_frames_).size())) {}
-
-  auto MaybeRender(size_t frame_index) -> void {
-    if (!show_progress_ || (frame_index % interval_ != 0)) {
+  static constexpr double kDefaultRendersPerSecond = 10.0;
+  static constexpr std::chrono::seconds kLogInterval{10};
+
+  explicit ProgressBar(uint64_t total_bytes = 0, std::ostream& out = std::cout,
+                       int fd = STDOUT_FILENO,
+                       double renders_per_second = kDefaultRendersPerSecond)
+      : out_(out),
+        terminal_(isatty(fd) != 0),
+        render_interval_(terminal_ ? std::chrono::duration_cast<Clock::duration>(
+                                         std::chrono::duration<double>(1.0 / renders_per_second))
+                                   : std::chrono::duration_cast<Clock::duration>(kLogInterval)),
+        total_bytes_(total_bytes),
+        start_time_(Clock::now()) {
+    bar_.reserve(kBarWidth * 3);
+  }
+
+  ProgressBar(const ProgressBar&) = delete;
+  ProgressBar(ProgressBar&&) = delete;
+  auto operator=(const ProgressBar&) -> ProgressBar& = delete;
+  auto operator=(ProgressBar&&) -> ProgressBar& = delete;
+  ~ProgressBar() { RestoreCursor(); }
+
+  // More input discovered after construction, e.g. another file.
+  void AddTotal(uint64_t bytes) { total_bytes_.fetch_add(bytes, std::memory_order_relaxed); }
+
+  // Input that needs no work (already converted, or past an event limit). It
+  // counts toward the percentage but not toward the throughput.
+  void Skip(uint64_t bytes) {
+    done_bytes_.fetch_add(bytes, std::memory_order_relaxed);
+    skipped_bytes_.fetch_add(bytes, std::memory_order_relaxed);
+  }
+
+  void Advance(uint64_t bytes, uint64_t events) {
+    done_bytes_.fetch_add(bytes, std::memory_order_relaxed);
+    events_.fetch_add(events, std::memory_order_relaxed);
+    const auto now = Clock::now().time_since_epoch().count();
+    auto due = next_render_.load(std::memory_order_relaxed);
+    if (now < due) {
       return;
     }
-    Render(frame_index);
+    // One thread claims this render slot; the others keep working.
+    const auto next = now + render_interval_.count();
+    if (next_render_.compare_exchange_strong(due, next, std::memory_order_relaxed)) {
+      Render(false);
+    }
+  }
+
+  [[nodiscard]] auto DoneBytes() const -> uint64_t {
+    return done_bytes_.load(std::memory_order_relaxed);
+  }
+
+  // Erases the bar so other output can be printed; the next render redraws it.
+  void Clear() {
+    std::lock_guard<std::mutex> lock(render_mutex_);
+    if (terminal_ && drawn_) {
+      out_ << "\r\033[2K" << std::flush;
+      drawn_ = false;
+    }
   }
 
-  auto Finish() -> void {
-    if (!show_progress_) {
+  // Final state: a last log line, or an erased bar on a terminal.
+  void Finish() {
+    if (!terminal_) {
+      Render(true);
       return;
     }
-    Render(display_total_frames_);
-    std::cout << "\r\033[2K" << std::flush;
+    Clear();
+    std::lock_guard<std::mutex> lock(render_mutex_);
     RestoreCursor();
   }
 
  private:
-  auto EnsureCursorHidden() -> void {
+  using Clock = std::chrono::steady_clock;
+  static constexpr size_t kBarWidth = 30;
+
+  void Render(bool final_line) {
+    std::lock_guard<std::mutex> lock(render_mutex_);
+    const auto now = Clock::now();
+    const uint64_t total = total_bytes_.load(std::memory_order_relaxed);
+    const uint64_t done = std::min(done_bytes_.load(std::memory_order_relaxed), total);
+    const uint64_t skipped = skipped_bytes_.load(std::memory_order_relaxed);
+    const uint64_t events = events_.load(std::memory_order_relaxed);
+    const double ratio =
+        total == 0 ? 1.0 : static_cast<double>(done) / static_cast<double>(total);
+    const double elapsed = std::chrono::duration<double>(now - start_time_).count();
+    const uint64_t worked = done - std::min(done, skipped);
+    const double bytes_per_second = elapsed > 0.0 ? static_cast<double>(worked) / elapsed : 0.0;
+    const double events_per_second = elapsed > 0.0 ? static_cast<double>(events) / elapsed : 0.0;
+
+    std::array<char, 32> eta{};
+    if (bytes_per_second > 0.0) {
+      const auto seconds =
+          static_cast<uint64_t>(static_cast<double>(total - done) / bytes_per_second);
+      std::snprintf(eta.data(), eta.size(), "%02llu:%02llu:%02llu",  // NOLINT
+                    static_cast<unsigned long long>(seconds / 3600),  // NOLINT(google-runtime-int)
+                    static_cast<unsigned long long>(seconds / 60 % 60),  // NOLINT
+                    static_cast<unsigned long long>(seconds % 60));      // NOLINT
+    } else {
+      std::snprintf(eta.data(), eta.size(), "--:--:--");  // NOLINT
+    }
+    std::array<char, 160> line{};
+    std::snprintf(line.data(), line.size(),  // NOLINT
+                  "%5.1f%% %.1f/%.1f MB %.1f MB/s %.0f events/s ETA %s", ratio * 100.0,
+                  static_cast<double>(done) / 1e6, static_cast<double>(total) / 1e6,
+                  bytes_per_second / 1e6, events_per_second, eta.data());
+
+    if (!terminal_) {
+      out_ << "progress " << line.data() << (final_line ? " done" : "") << std::endl;
+      return;
+    }
+    static constexpr std::array<const char*, 9> kBlockChars = {
+        " ", "▏", "▎", "▍", "▌", "▋", "▊", "▉", "█"};
+    size_t filled = std::min(kBarWidth * 8, static_cast<size_t>(std::lround(
+                                                ratio * static_cast<double>(kBarWidth * 8))));
+    bar_.clear();
+    for (size_t i = 0; i < kBarWidth; ++i) {
+      bar_ += kBlockChars[std::min<size_t>(filled, 8)];  // NOLINT
+      filled = filled >= 8 ? filled - 8 : 0;
+    }
     if (!cursor_hidden_) {
-      std::cout << "\033[?25l" << std::flush;
+      out_ << "\033[?25l";
       cursor_hidden_ = true;
     }
+    out_ << "\r[" << bar_ << "] " << line.data() << "\033[K" << std::flush;
+    drawn_ = true;
   }
 
-  auto RestoreCursor() -> void {
+  void RestoreCursor() {
     if (cursor_hidden_) {
-      std::cout << "\033[?25h" << std::flush;
+      out_ << "\033[?25h" << std::flush;
       cursor_hidden_ = false;
     }
   }
 
-  auto Render(size_t frame_index) -> void {
-    EnsureCursorHidden();
-    const size_t clamped = std::min(frame_index, display_total_frames_);
-    const double ratio = display_total_frames_ == 0
-                             ? 1.0
-                             : static_cast<double>(clamped) /
-                                   static_cast<double>(display_total_frames_);
-    const double percent = ratio * 100.0;
-    const size_t total_subunits = bar_width_ * 8;
-    size_t filled_subunits = std::min(
-        total_subunits, static_cast<size_t>(std::lround(
-                            ratio * static_cast<double>(total_subunits))));
-    static constexpr std::array<const char*, 9> kBlockChars = {
-        " ", "▏", "▎", "▍", "▌", "▋", "▊", "▉", "█"};
-    std::string bar;
-    bar.reserve(bar_width_ * 3);
-    for (size_t i = 0; i < bar_width_; ++i) {
-      const size_t units = std::min<size_t>(filled_subunits, 8);
-      bar += kBlockChars[units];  // NOLINT
-      filled_subunits = (filled_subunits >= 8) ? (filled_subunits - 8) : 0;
-    }
-    std::ostringstream oss;
-    oss << '[' << bar << "] " << std::fixed << std::setprecision(1)
-        << std::setw(5) << percent << "% " << std::setw(frame_counter_width_)
-        << clamped << '/' << std::setw(frame_counter_width_)
-        << display_total_frames_;
-    std::cout << '\r' << oss.str() << std::flush;
-  }
-
-  size_t total_frames_ = 0;
-  size_t interval_ = 100;
-  std::size_t bar_width_ = 50;
-  bool show_progress_ = false;
-  size_t display_total_frames_ = 1;
-  int frame_counter_width_ = 1;
+  std::ostream& out_;
+  const bool terminal_;
+  const Clock::duration render_interval_;
+  std::atomic<uint64_t> total_bytes_{0};
+  std::atomic<uint64_t> done_bytes_{0};
+  std::atomic<uint64_t> skipped_bytes_{0};
+  std::atomic<uint64_t> events_{0};
+  std::atomic<Clock::rep> next_render_{0};
+  std::mutex render_mutex_;
+  std::string bar_;
+  // Rates and ETA are measured from construction, so the work before the
+  // first render is included.
+  const Clock::time_point start_time_;
+  bool drawn_ = false;
   bool cursor_hidden_ = false;
 };
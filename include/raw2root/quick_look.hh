@@ -0,0 +1,207 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "channel_stats_sink.hh"
+#include "decode_pipeline.hh"
+
+// Quick-look histograms of a running readout. A sample of each detector's
+// frames (one in sample_every) is decoded on a FrameTap worker into
+// per-channel hit counts, raw ADC and ADC-CMN spectra, and an event rate, so
+// a dead ASIC, a noisy strip or a wrong threshold shows up in the first
+// minute instead of after conversion. AddFrame runs on the tap worker;
+// everything else may be called from any thread.
+class QuickLook {
+ public:
+  static constexpr size_t kAdcBins = 1024;  // 10-bit ADC
+  using AdcHistogram = std::array<uint32_t, kAdcBins>;
+
+  struct DetectorSummary {
+    uint8_t address = 0;
+    uint64_t frames = 0;  // decoded frames, i.e. the sampled ones
+    uint64_t events = 0;
+    uint64_t pseudo_events = 0;
+    uint64_t invalid_events = 0;
+    // Frames whose decoding stopped on a corrupt event; the events before it
+    // are kept.
+    uint64_t decode_errors = 0;
+    // Events per second of all frames: the sampled rate times sample_every.
+    double event_rate = 0.0;
+    std::array<uint64_t, kAsicNum> asic_hits{};
+    // Channels that are not ok, as (asic * kChannelNum + channel, status).
+    std::vector<std::pair<size_t, ChannelStatus>> bad_channels;
+  };
+
+  QuickLook(const std::vector<uint8_t>& addresses, uint32_t sample_every)
+      : sample_every_(sample_every) {
+    for (const auto address : addresses) {
+      detectors_.emplace(address, std::make_unique<Detector>());
+    }
+  }
+
+  [[nodiscard]] auto SampleEvery() const -> uint32_t { return sample_every_; }
+
+  void AddFrame(uint8_t address, std::string_view frame) {
+    const auto found = detectors_.find(address);
+    if (found == detectors_.end()) {
+      return;
+    }
+    auto& detector = *found->second;
+    // As in OnlinePedestal: decoding touches only this detector's scratch
+    // state, so the lock covers the histograms alone.
+    detector.analyzer.Initialize(reinterpret_cast<const uint8_t*>(frame.data()),  // NOLINT
+                                 frame.size());
+    detector.events.clear();
+    detector.events.emplace_back();
+    // Quick look exists to catch misbehaving detectors, so it must survive
+    // the corrupt frames they send: an analyzer exception ends this frame's
+    // decoding and is counted, never propagated to the tap worker.
+    bool failed = false;
+    try {
+      while (detector.analyzer.UnpackNextEvent(detector.events.back())) {
+        detector.events.emplace_back();
+      }
+    } catch (const std::exception&) {
+      failed = true;
+    }
+    detector.events.pop_back();
+    const auto now = std::chrono::steady_clock::now();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    detector.decode_errors += failed ? 1 : 0;
+    for (const auto& event : detector.events) {
+      detector.channels.OnEvent(event, detector.frames);
+      if (!event.valid) {
+        ++detector.invalid_events;
+        continue;
+      }
+      ++detector.events_total;
+      detector.pseudo_events += event.is_pseudo_event ? 1 : 0;
+      for (size_t asic = 0; asic < kAsicNum; ++asic) {
+        const auto& data = event.asic_data[asic];  // NOLINT
+        for (size_t channel = 0; channel < kChannelNum; ++channel) {
+          if (data.chflag.test(channel)) {
+            const auto value = static_cast<size_t>(data.adc_data[channel]) % kAdcBins;  // NOLINT
+            ++detector.adc[asic * kChannelNum + channel][value];  // NOLINT
+          }
+        }
+      }
+    }
+    if (detector.frames == 0) {
+      detector.first_frame = now;
+    }
+    detector.last_frame = now;
+    ++detector.frames;
+  }
+
+  // Frames the tap dropped because decoding fell behind.
+  void SetDropped(uint64_t dropped) { dropped_.store(dropped, std::memory_order_relaxed); }
+  [[nodiscard]] auto Dropped() const -> uint64_t {
+    return dropped_.load(std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] auto Summary() const -> std::vector<DetectorSummary> {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<DetectorSummary> summaries;
+    for (const auto& [address, detector] : detectors_) {
+      DetectorSummary summary;
+      summary.address = address;
+      summary.frames = detector->frames;
+      summary.events = detector->events_total;
+      summary.pseudo_events = detector->pseudo_events;
+      summary.invalid_events = detector->invalid_events;
+      summary.decode_errors = detector->decode_errors;
+      const double seconds =
+          std::chrono::duration<double>(detector->last_frame - detector->first_frame).count();
+      if (seconds > 0.0) {
+        summary.event_rate =
+            static_cast<double>(detector->events_total) * sample_every_ / seconds;
+      }
+      const auto stats = detector->channels.Stats();
+      for (size_t index = 0; index < stats.size(); ++index) {
+        summary.asic_hits[index / kChannelNum] += stats[index].hits;  // NOLINT
+        if (stats[index].status != ChannelStatus::kOk) {
+          summary.bad_channels.emplace_back(index, stats[index].status);
+        }
+      }
+      summaries.push_back(std::move(summary));
+    }
+    return summaries;
+  }
+
+  // The channel map of one detector, in the layout of raw2root --sinks
+  // channels, so it can feed disable_channels. False for an unknown address.
+  auto WriteChannelMap(uint8_t address, std::ostream& out) const -> bool {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto found = detectors_.find(address);
+    if (found == detectors_.end()) {
+      return false;
+    }
+    found->second->channels.WriteMap(out);
+    return true;
+  }
+
+  // Both spectra of one detector as "<kind> <asic> <channel> <value> <count>"
+  // lines, kind being adc or adc_cmn, for every non-empty bin.
+  auto WriteSpectra(uint8_t address, std::ostream& out) const -> bool {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto found = detectors_.find(address);
+    if (found == detectors_.end()) {
+      return false;
+    }
+    const auto& detector = *found->second;
+    out << "# kind asic channel value count\n";
+    for (size_t asic = 0; asic < kAsicNum; ++asic) {
+      for (size_t channel = 0; channel < kChannelNum; ++channel) {
+        const auto& adc = detector.adc[asic * kChannelNum + channel];  // NOLINT
+        for (size_t bin = 0; bin < kAdcBins; ++bin) {
+          if (adc[bin] != 0) {  // NOLINT
+            out << "adc " << asic << ' ' << channel << ' ' << bin << ' ' << adc[bin]  // NOLINT
+                << '\n';
+          }
+        }
+        const auto& cmn = detector.channels.Histogram(asic, channel);
+        for (size_t bin = 0; bin < PedestalSink::kBins; ++bin) {
+          if (cmn[bin] != 0) {  // NOLINT
+            out << "adc_cmn " << asic << ' ' << channel << ' '
+                << static_cast<int>(bin) - PedestalSink::kOffset << ' ' << cmn[bin]  // NOLINT
+                << '\n';
+          }
+        }
+      }
+    }
+    return true;
+  }
+
+ private:
+  struct Detector {
+    cdtedsd::FrameAnalyzer<kAsicNum, kChannelNum> analyzer{};
+    std::vector<DecodedEvent> events;
+    ChannelStatsSink channels;
+    std::vector<AdcHistogram> adc = std::vector<AdcHistogram>(kAsicNum * kChannelNum);
+    uint64_t frames = 0;
+    uint64_t events_total = 0;
+    uint64_t pseudo_events = 0;
+    uint64_t invalid_events = 0;
+    uint64_t decode_errors = 0;
+    std::chrono::steady_clock::time_point first_frame{};
+    std::chrono::steady_clock::time_point last_frame{};
+  };
+
+  uint32_t sample_every_ = 1;
+  std::atomic<uint64_t> dropped_{0};
+  mutable std::mutex mutex_;
+  std::map<uint8_t, std::unique_ptr<Detector>> detectors_;
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+#include "decode_pipeline.hh"
+
+// Event, pseudo-event and livetime counters for rate/livetime summaries.
+// ti and livetime are reported in raw counter ticks.
+class RateSink : public EventSink {
+ public:
+  void OnEvent(const DecodedEvent& event, size_t /*frame_index*/) override {
+    if (!event.valid) {
+      ++invalid_events_;
+      return;
+    }
+    if (events_ == 0) {
+      first_ti_ = event.ti;
+      first_event_counter_ = event.event_counter;
+    }
+    // ti is a free-running 32-bit counter; accumulate deltas so the span
+    // survives wrap-around.
+    if (events_ > 0) {
+      ti_span_ += static_cast<uint32_t>(event.ti - last_ti_);
+    }
+    last_ti_ = event.ti;
+    last_event_counter_ = event.event_counter;
+    livetime_sum_ += event.livetime;
+    ++events_;
+    if (event.is_pseudo_event) {
+      ++pseudo_events_;
+    }
+  }
+
+  void WriteSummary(std::ostream& out) const {
+    out << "events " << events_ << "\n"
+        << "pseudo_events " << pseudo_events_ << "\n"
+        << "invalid_events " << invalid_events_ << "\n"
+        << "first_ti " << first_ti_ << "\n"
+        << "last_ti " << last_ti_ << "\n"
+        << "ti_span " << ti_span_ << "\n"
+        << "first_event_counter " << first_event_counter_ << "\n"
+        << "last_event_counter " << last_event_counter_ << "\n"
+        << "livetime_sum " << livetime_sum_ << "\n";
+    if (ti_span_ > 0) {
+      out << "events_per_ti_tick " << static_cast<double>(events_) / static_cast<double>(ti_span_)
+          << "\n";
+    }
+  }
+
+ private:
+  uint64_t events_ = 0;
+  uint64_t pseudo_events_ = 0;
+  uint64_t invalid_events_ = 0;
+  uint32_t first_ti_ = 0;
+  uint32_t last_ti_ = 0;
+  uint64_t ti_span_ = 0;
+  uint32_t first_event_counter_ = 0;
+  uint32_t last_event_counter_ = 0;
+  uint64_t livetime_sum_ = 0;
+};
@@ -113,6 +113,22 @@ class RawDataFile {
     }
   }
 
+  // Byte offset just past the last complete frame (or HK block) consumed.
+  auto GetPosition() -> uint64_t {
+    if (file_.eof()) {
+      file_.clear();
+    }
+    const auto pos = file_.tellg();
+    return pos < 0 ? 0 : static_cast<uint64_t>(pos);
+  }
+
+  // Resume reading at a frame boundary previously returned by GetPosition().
+  auto Seek(uint64_t offset) -> bool {
+    file_.clear();
+    file_.seekg(static_cast<std::streamoff>(offset), std::ios::beg);
+    return static_cast<bool>(file_);
+  }
+
   auto GetFrame() const -> const std::vector<char>& { return frame_; }
   auto IsOldFormat() const -> bool { return is_old_format_; }
   auto GetMisalignmentCount() const -> uint64_t { return misalignment_count_; }
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+// Readout file naming shared by the offline tools: per-detector files end in
+// _0xNN, chunks of a rotated output add _NNNNNN.
+
+// "0x35" for ".../run_0x35" and its chunks ".../run_0x35_000012" (the readout
+// naming), otherwise the file name.
+inline auto detector_key(const std::string& path) -> std::string {
+  const std::string name = std::filesystem::path(path).filename().string();
+  const auto marker = name.rfind("_0x");
+  if (marker != std::string::npos) {
+    std::string digits = name.substr(marker + 3);
+    const auto chunk = digits.find('_');
+    if (chunk != std::string::npos && chunk + 1 < digits.size() &&
+        std::all_of(digits.begin() + static_cast<std::ptrdiff_t>(chunk) + 1, digits.end(),
+                    [](unsigned char c) { return std::isdigit(c) != 0; })) {
+      digits.resize(chunk);
+    }
+    if (!digits.empty() && digits.size() <= 2 &&
+        std::all_of(digits.begin(), digits.end(),
+                    [](unsigned char c) { return std::isxdigit(c) != 0; })) {
+      std::string key = "0x" + digits;
+      std::transform(key.begin() + 2, key.end(), key.begin() + 2,
+                     [](unsigned char c) { return static_cast<char>(std::toupper(c)); });
+      return key;
+    }
+  }
+  return name;
+}
+
+// A path that is not a regular file is treated as a run prefix and expands to
+// every <prefix>_0xNN file, or every <prefix><kind>_0xNN file for a kind such
+// as "_hk".
+inline auto expand_run_input(const std::string& input, const std::string& kind = "")
+    -> std::vector<std::string> {
+  if (std::filesystem::is_regular_file(input)) {
+    return {input};
+  }
+  const std::filesystem::path prefix(input);
+  const auto directory =
+      prefix.has_parent_path() ? prefix.parent_path() : std::filesystem::path(".");
+  const std::string stem = prefix.filename().string() + kind + "_0x";
+  std::vector<std::string> files;
+  std::error_code error;
+  for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+    const std::string name = entry.path().filename().string();
+    if (entry.is_regular_file() && name.rfind(stem, 0) == 0 && detector_key(name) != name) {
+      files.push_back(
+          (prefix.has_parent_path() ? entry.path() : entry.path().filename()).string());
+    }
+  }
+  if (files.empty()) {
+    throw std::runtime_error("No " + (kind.empty() ? std::string("raw") : kind.substr(1)) +
+                             " file or run matches " + input);
+  }
+  std::sort(files.begin(), files.end());
+  return files;
+}
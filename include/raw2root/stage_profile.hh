@@ -0,0 +1,65 @@
+#pragma once
+
+#include <time.h>
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// Accumulated cost of one processing stage. Each instance is only updated
+// from one thread; read it after that thread has been joined.
+struct StageTimes {
+  uint64_t wall_ns = 0;
+  uint64_t cpu_ns = 0;
+  uint64_t calls = 0;
+  uint64_t bytes = 0;
+  uint64_t events = 0;
+};
+
+// Measures one stage invocation: steady_clock for wall time and the calling
+// thread's CPU clock, so stages on the decode worker are not charged for the
+// main thread's work and vice versa. A span covering every thread, like the
+// whole conversion, passes CLOCK_PROCESS_CPUTIME_ID instead.
+class StageClock {
+ public:
+  explicit StageClock(clockid_t cpu_clock = CLOCK_THREAD_CPUTIME_ID)
+      : wall_start_(std::chrono::steady_clock::now()),
+        cpu_clock_(cpu_clock),
+        cpu_start_(CpuNs(cpu_clock)) {}
+
+  void Stop(StageTimes& times, uint64_t bytes = 0, uint64_t events = 0) const {
+    const auto wall = std::chrono::steady_clock::now() - wall_start_;
+    times.wall_ns += static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(wall).count());
+    times.cpu_ns += CpuNs(cpu_clock_) - cpu_start_;
+    ++times.calls;
+    times.bytes += bytes;
+    times.events += events;
+  }
+
+ private:
+  static auto CpuNs(clockid_t clock) -> uint64_t {
+    timespec now{};
+    clock_gettime(clock, &now);
+    return static_cast<uint64_t>(now.tv_sec) * 1000000000ULL + static_cast<uint64_t>(now.tv_nsec);
+  }
+
+  std::chrono::steady_clock::time_point wall_start_;
+  clockid_t cpu_clock_;
+  uint64_t cpu_start_ = 0;
+};
+
+// One "profile key=value ..." line per stage, easy to grep and to load with
+// pandas/awk. Rates are relative to the stage's own wall time.
+inline void write_stage_profile(std::ostream& out, const std::string& file,
+                                const std::string& stage, const StageTimes& times) {
+  const double wall_s = static_cast<double>(times.wall_ns) * 1e-9;
+  const double cpu_s = static_cast<double>(times.cpu_ns) * 1e-9;
+  const double mb_per_s = wall_s > 0.0 ? static_cast<double>(times.bytes) / 1e6 / wall_s : 0.0;
+  const double events_per_s = wall_s > 0.0 ? static_cast<double>(times.events) / wall_s : 0.0;
+  out << "profile file=" << file << " stage=" << stage << " wall_s=" << wall_s
+      << " cpu_s=" << cpu_s << " calls=" << times.calls << " bytes=" << times.bytes
+      << " events=" << times.events << " mb_per_s=" << mb_per_s
+      << " events_per_s=" << events_per_s << "\n";
+}
@@ -0,0 +1,675 @@
+#pragma once
+#include <absl/strings/cord.h>
+#include <fcntl.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <linux/falloc.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include "frame_ring.hh"
+#if defined(HERO_SHELL_HAVE_ZSTD)
+#include "zstd_seekable.hh"
+#endif
+
+// How a readout output file trades memory and syscalls for durability.
+//
+//   buffer_bytes    bytes collected in user space before one write(2)
+//   flush_interval  buffered data older than this is handed to the kernel,
+//                   so readers of a growing file never lag by more than it
+//   sync_interval   fdatasync at most this long after the previous one
+//   sync_bytes      fdatasync after this many bytes since the previous one
+//
+// A zero interval or byte count disables that trigger. Close always flushes
+// and syncs, so a readout that stops normally leaves complete files on disk.
+//
+//   preallocate        reserve disk space ahead of the data, so files growing
+//                      side by side get large extents instead of interleaved
+//                      small ones; Close truncates to the data written
+//   preallocate_bytes  expected file size, reserved at open; past it (or
+//                      without it) space is reserved in extents sized from
+//                      the measured write rate
+//   direct_io          bypass the page cache (O_DIRECT, F_NOCACHE on macOS),
+//                      so a long run does not evict everything else; only
+//                      whole 4 KiB blocks are written until Close
+struct WriterPolicy {
+  static constexpr size_t kDefaultBufferBytes = size_t{8} << 20;
+
+  size_t buffer_bytes = kDefaultBufferBytes;
+  std::chrono::nanoseconds flush_interval = std::chrono::seconds(1);
+  std::chrono::nanoseconds sync_interval = std::chrono::seconds(5);
+  uint64_t sync_bytes = 0;
+  bool preallocate = false;
+  uint64_t preallocate_bytes = 0;
+  bool direct_io = false;
+};
+
+inline constexpr bool kHavePreallocate =
+#if defined(__linux__) || defined(__APPLE__)
+    true;
+#else
+    false;
+#endif
+
+inline constexpr bool kHaveDirectIo =
+#if defined(O_DIRECT) || defined(F_NOCACHE)
+    true;
+#else
+    false;
+#endif
+
+// Append-only file writer with one large page-aligned buffer. It replaces a
+// std::ofstream flushed after every frame: frames are copied into the buffer
+// and reach the disk in buffer-sized writes, with fdatasync driven by the
+// policy instead of by frame arrival. Not thread-safe; each file has a single
+// writer.
+class BufferedFileWriter {
+ public:
+  static constexpr size_t kAlignment = 4096;
+
+  explicit BufferedFileWriter(WriterPolicy policy = WriterPolicy()) : policy_(policy) {}
+
+  BufferedFileWriter(const BufferedFileWriter&) = delete;
+  BufferedFileWriter(BufferedFileWriter&&) = delete;
+  auto operator=(const BufferedFileWriter&) -> BufferedFileWriter& = delete;
+  auto operator=(BufferedFileWriter&&) -> BufferedFileWriter& = delete;
+  ~BufferedFileWriter() { (void)Close(); }
+
+  // Creates or truncates path. On failure Error() describes the cause. After
+  // Close the writer may be opened again on another path; the buffer is kept.
+  auto Open(const std::string& path) -> bool {
+    path_ = path;
+    error_.clear();
+    used_ = 0;
+    bytes_written_ = synced_bytes_ = 0;
+    if (!buffer_) {
+      const size_t capacity = std::max(
+          kAlignment, (policy_.buffer_bytes + kAlignment - 1) / kAlignment * kAlignment);
+      buffer_.reset(static_cast<char*>(std::aligned_alloc(kAlignment, capacity)));
+      if (!buffer_) {
+        return Fail("cannot allocate write buffer");
+      }
+      capacity_ = capacity;
+    }
+    int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+#if defined(O_DIRECT)
+    flags |= policy_.direct_io ? O_DIRECT : 0;
+#endif
+    fd_ = ::open(path.c_str(), flags, 0644);  // NOLINT
+    if (fd_ < 0) {
+      return Fail(policy_.direct_io && errno == EINVAL
+                      ? "direct I/O is not supported on this file system"
+                      : std::strerror(errno));
+    }
+#if defined(F_NOCACHE)
+    if (policy_.direct_io && ::fcntl(fd_, F_NOCACHE, 1) != 0) {
+      return Fail(std::strerror(errno));
+    }
+#endif
+    direct_ = policy_.direct_io;
+    reserved_ = 0;
+    preallocate_ = policy_.preallocate;
+    opened_ = last_flush_ = last_sync_ = Clock::now();
+    if (preallocate_ && policy_.preallocate_bytes > 0) {
+      Reserve(policy_.preallocate_bytes);
+    }
+    return true;
+  }
+
+  [[nodiscard]] auto IsOpen() const -> bool { return fd_ >= 0; }
+  [[nodiscard]] auto Error() const -> const std::string& { return error_; }
+  [[nodiscard]] auto Path() const -> const std::string& { return path_; }
+  // Bytes accepted by Append, including any still buffered.
+  [[nodiscard]] auto BytesWritten() const -> uint64_t { return bytes_written_; }
+
+  auto Append(const char* data, size_t size) -> bool {
+    if (fd_ < 0) {
+      return Fail("file is not open");
+    }
+    while (size > 0) {
+      if (used_ == capacity_ && !Flush()) {
+        return false;
+      }
+      const size_t chunk = std::min(size, capacity_ - used_);
+      std::memcpy(buffer_.get() + used_, data, chunk);  // NOLINT
+      used_ += chunk;
+      data += chunk;  // NOLINT
+      size -= chunk;
+      bytes_written_ += chunk;
+    }
+    return ApplyPolicy();
+  }
+
+  // Hands buffered bytes to the kernel. With direct I/O only whole blocks
+  // are written; the partial block stays buffered until more data or Close.
+  auto Flush() -> bool {
+    const size_t length = direct_ ? used_ / kAlignment * kAlignment : used_;
+    if (preallocate_ && bytes_written_ - used_ + length > reserved_) {
+      Extend(bytes_written_ - used_ + length);
+    }
+    size_t offset = 0;
+    while (offset < length) {
+      const ssize_t written = ::write(fd_, buffer_.get() + offset, length - offset);  // NOLINT
+      if (written < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        return Fail(std::strerror(errno));
+      }
+      offset += static_cast<size_t>(written);
+    }
+    if (length < used_) {
+      std::memmove(buffer_.get(), buffer_.get() + length, used_ - length);  // NOLINT
+    }
+    used_ -= length;
+    last_flush_ = Clock::now();
+    return true;
+  }
+
+  // Flush, then wait until the data is on stable storage.
+  auto Sync() -> bool {
+    if (!Flush()) {
+      return false;
+    }
+#if defined(__APPLE__)
+    const int result = ::fsync(fd_);
+#else
+    const int result = ::fdatasync(fd_);
+#endif
+    if (result != 0) {
+      return Fail(std::strerror(errno));
+    }
+    last_sync_ = Clock::now();
+    synced_bytes_ = bytes_written_ - used_;
+    return true;
+  }
+
+  // Applies the time-based triggers without new data; call it while idle.
+  auto Poll() -> bool { return ApplyPolicy(); }
+
+  // Flushes, syncs and closes. Safe to call more than once. A preallocated
+  // file is truncated to the bytes written, which also releases the unused
+  // reservation past the end.
+  auto Close() -> bool {
+    if (fd_ < 0) {
+      return error_.empty();
+    }
+    bool ok = true;
+#if defined(O_DIRECT)
+    // The last partial block cannot be written with O_DIRECT.
+    if (direct_ && used_ % kAlignment != 0) {
+      ok = Flush();
+      const int flags = ::fcntl(fd_, F_GETFL);
+      if (ok && (flags < 0 || ::fcntl(fd_, F_SETFL, flags & ~O_DIRECT) != 0)) {
+        ok = Fail(std::strerror(errno));
+      }
+      direct_ = !ok;
+    }
+#endif
+    ok = ok && Sync();
+    if (ok && reserved_ > 0 && ::ftruncate(fd_, static_cast<off_t>(bytes_written_)) != 0) {
+      ok = Fail(std::strerror(errno));
+    }
+    if (::close(fd_) != 0 && ok) {
+      ok = Fail(std::strerror(errno));
+    }
+    fd_ = -1;
+    return ok;
+  }
+
+  // Bytes of disk space reserved ahead of the data so far.
+  [[nodiscard]] auto Reserved() const -> uint64_t { return reserved_; }
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  struct FreeDeleter {
+    void operator()(char* buffer) const { std::free(buffer); }  // NOLINT
+  };
+
+  auto ApplyPolicy() -> bool {
+    if (fd_ < 0 || bytes_written_ == synced_bytes_) {
+      return true;
+    }
+    const bool sync_by_bytes =
+        policy_.sync_bytes > 0 && bytes_written_ - synced_bytes_ >= policy_.sync_bytes;
+    const bool timed = policy_.sync_interval.count() > 0 || policy_.flush_interval.count() > 0;
+    const auto now = timed ? Clock::now() : Clock::time_point();
+    if (sync_by_bytes ||
+        (policy_.sync_interval.count() > 0 && now - last_sync_ >= policy_.sync_interval)) {
+      return Sync();
+    }
+    if (used_ > 0 && policy_.flush_interval.count() > 0 &&
+        now - last_flush_ >= policy_.flush_interval) {
+      return Flush();
+    }
+    return true;
+  }
+
+  auto Fail(const std::string& reason) -> bool {
+    error_ = path_ + ": " + reason;
+    return false;
+  }
+
+  // Reserves [reserved_, end) without changing the file size, so readers and
+  // a crash see only the data written. A file system without preallocation
+  // or without the space just gets no reservation: it is an optimization,
+  // never a reason to fail the readout.
+  void Reserve(uint64_t end) {
+    if (end <= reserved_) {
+      return;
+    }
+#if defined(__linux__)
+    const int result = ::fallocate(fd_, FALLOC_FL_KEEP_SIZE, static_cast<off_t>(reserved_),
+                                   static_cast<off_t>(end - reserved_));
+#elif defined(__APPLE__)
+    fstore_t store{F_ALLOCATECONTIG | F_ALLOCATEALL, F_PEOFPOSMODE, 0,
+                   static_cast<off_t>(end - reserved_), 0};
+    int result = ::fcntl(fd_, F_PREALLOCATE, &store);
+    if (result != 0) {
+      store.fst_flags = F_ALLOCATEALL;
+      result = ::fcntl(fd_, F_PREALLOCATE, &store);
+    }
+#else
+    const int result = -1;
+#endif
+    if (result != 0) {
+      preallocate_ = false;
+      return;
+    }
+    reserved_ = end;
+  }
+
+  // Reserves up to needed plus the data expected in the next kLookahead at
+  // the rate measured since Open, within [kMinExtent, kMaxExtent].
+  void Extend(uint64_t needed) {
+    constexpr uint64_t kMinExtent = uint64_t{64} << 20;
+    constexpr uint64_t kMaxExtent = uint64_t{1} << 30;
+    constexpr double kLookahead = 60.0;
+    const double seconds = std::chrono::duration<double>(Clock::now() - opened_).count();
+    const double rate = seconds > 0.0 ? static_cast<double>(needed) / seconds : 0.0;
+    const auto extent =
+        std::clamp(static_cast<uint64_t>(rate * kLookahead), kMinExtent, kMaxExtent);
+    Reserve(needed + extent);
+  }
+
+  WriterPolicy policy_;
+  std::string path_;
+  std::string error_;
+  std::unique_ptr<char, FreeDeleter> buffer_;
+  size_t capacity_ = 0;
+  size_t used_ = 0;
+  int fd_ = -1;
+  bool direct_ = false;
+  bool preallocate_ = false;
+  uint64_t reserved_ = 0;  // file offset up to which space is reserved
+  uint64_t bytes_written_ = 0;
+  uint64_t synced_bytes_ = 0;
+  Clock::time_point opened_{};
+  Clock::time_point last_flush_{};
+  Clock::time_point last_sync_{};
+};
+
+// Optional zstd compression of a readout file, in the seekable format: one
+// independent zstd frame per chunk_bytes of raw data plus a seek table.
+// Only available when built with HERO_SHELL_HAVE_ZSTD.
+struct CompressionPolicy {
+  static constexpr size_t kDefaultChunkBytes = size_t{1} << 20;
+
+  bool enabled = false;
+  int level = 3;
+  int threads = 0;  // zstd worker threads per file; 0 compresses on the writer thread
+  size_t chunk_bytes = kDefaultChunkBytes;
+};
+
+inline constexpr bool kHaveZstd =
+#if defined(HERO_SHELL_HAVE_ZSTD)
+    true;
+#else
+    false;
+#endif
+
+// Raw bytes in, compressed bytes out, and time spent compressing.
+struct CompressionStats {
+  uint64_t raw_bytes = 0;
+  uint64_t compressed_bytes = 0;
+  std::chrono::nanoseconds busy{};
+
+  [[nodiscard]] auto Ratio() const -> double {
+    return compressed_bytes > 0
+               ? static_cast<double>(raw_bytes) / static_cast<double>(compressed_bytes)
+               : 0.0;
+  }
+  [[nodiscard]] auto BytesPerSecond() const -> double {
+    const double seconds = std::chrono::duration<double>(busy).count();
+    return seconds > 0.0 ? static_cast<double>(raw_bytes) / seconds : 0.0;
+  }
+};
+
+// When a readout output rolls over into numbered chunks. The thresholds apply
+// to the current chunk: its frames, its raw (uncompressed) bytes, and the time
+// since it was opened. The first one reached closes the chunk at the next
+// frame boundary, so a frame never straddles two chunks. All zero: one file.
+struct RotationPolicy {
+  uint64_t frames = 0;
+  uint64_t bytes = 0;
+  std::chrono::nanoseconds interval{};
+
+  [[nodiscard]] auto Enabled() const -> bool {
+    return frames > 0 || bytes > 0 || interval.count() > 0;
+  }
+};
+
+// One closed output chunk. Once reported it is synced and never written again.
+struct ChunkInfo {
+  std::string path;
+  uint32_t index = 0;
+  uint64_t frames = 0;
+  uint64_t raw_bytes = 0;
+  uint64_t file_bytes = 0;  // differs from raw_bytes when compressed
+  std::chrono::system_clock::time_point opened{};
+  std::chrono::system_clock::time_point closed{};
+};
+
+// Fill level of one writer's ring, in frames.
+struct RingStats {
+  size_t used = 0;
+  size_t capacity = 0;
+  size_t high_water = 0;
+  uint64_t full_waits = 0;
+};
+
+// A BufferedFileWriter drained by its own thread from a FrameRing, so the
+// thread receiving frames never waits for the disk. Frames travel as Cords:
+// the receiver moves the reply payload into a slot without copying or
+// flattening it, and the writer copies its chunks straight into the aligned
+// write buffer, the only copy on the way to write(2).
+//
+// With compression enabled the writer thread also runs the zstd encoder, so
+// compression stays off the receive path and each detector compresses in
+// parallel with the others.
+//
+// With a RotationPolicy the output is a series of chunk files named by
+// ChunkPath. The writer thread closes the current chunk when a threshold is
+// reached and opens the next one only when another frame arrives, so a run
+// never ends with an empty chunk.
+//
+// Push is for a single producer thread; when the ring is full it waits for a
+// free slot rather than dropping data, and counts the wait.
+class RingFileWriter {
+ public:
+  // Called on the writer thread after each frame is accepted by the file.
+  using OnWritten = std::function<void(const absl::Cord& frame)>;
+  // Called on the writer thread when a write fails; the frame is discarded.
+  using OnError = std::function<void(const std::string& error)>;
+  // Path of chunk index of a rotated output.
+  using ChunkPath = std::function<std::string(uint32_t index)>;
+  // Called with the path of each chunk once it is open, including the first.
+  using OnChunkOpened = std::function<void(const std::string& path)>;
+  // Called once a chunk is complete and closed. Chunks closed by rotation are
+  // reported on the writer thread, the last one on the thread calling Close.
+  using OnChunkClosed = std::function<void(const ChunkInfo& chunk)>;
+
+  static constexpr size_t kDefaultSlots = 512;
+
+  // Compression must be disabled unless built with HERO_SHELL_HAVE_ZSTD.
+  RingFileWriter(WriterPolicy policy, size_t slots,
+                 const CompressionPolicy& compression = CompressionPolicy())
+      : ring_(slots), file_(policy) {
+#if defined(HERO_SHELL_HAVE_ZSTD)
+    if (compression.enabled) {
+      encoder_ = std::make_unique<SeekableZstdEncoder>(compression.level, compression.threads,
+                                                       compression.chunk_bytes);
+    }
+#else
+    (void)compression;
+#endif
+  }
+
+  RingFileWriter(const RingFileWriter&) = delete;
+  RingFileWriter(RingFileWriter&&) = delete;
+  auto operator=(const RingFileWriter&) -> RingFileWriter& = delete;
+  auto operator=(RingFileWriter&&) -> RingFileWriter& = delete;
+  ~RingFileWriter() { Stop(); }
+
+  // Opens the file; Start launches the writer thread.
+  auto Open(const std::string& path) -> bool {
+    return OpenChunks([path](uint32_t /*index*/) { return path; }, RotationPolicy(), nullptr,
+                      nullptr);
+  }
+  // Opens chunk 0 of a rotated output. The callbacks may be null.
+  auto OpenChunks(ChunkPath path_of, const RotationPolicy& rotation, OnChunkOpened on_opened,
+                  OnChunkClosed on_closed) -> bool {
+    path_of_ = std::move(path_of);
+    rotation_ = rotation;
+    on_chunk_opened_ = std::move(on_opened);
+    on_chunk_closed_ = std::move(on_closed);
+    chunk_index_ = 0;
+    return OpenChunk();
+  }
+  void Start(OnWritten on_written, OnError on_error) {
+    on_written_ = std::move(on_written);
+    on_error_ = std::move(on_error);
+    worker_ = std::thread([this]() { Run(); });
+  }
+
+  void Push(absl::Cord&& frame) {
+    if (ring_.TryPush(frame)) {
+      return;
+    }
+    full_waits_.fetch_add(1, std::memory_order_relaxed);
+    while (!ring_.TryPush(frame)) {
+      std::this_thread::sleep_for(kFullWait);
+    }
+  }
+
+  // Writes every queued frame, then joins the writer thread. The file stays
+  // open until Close.
+  void Stop() {
+    stopping_.store(true, std::memory_order_release);
+    if (worker_.joinable()) {
+      worker_.join();
+    }
+  }
+
+  // Completes the compressed stream, if any, then flushes, syncs and closes
+  // the current chunk.
+  auto Close() -> bool { return !chunk_open_ || CloseChunk(); }
+
+  [[nodiscard]] auto IsOpen() const -> bool { return file_.IsOpen(); }
+  [[nodiscard]] auto Error() const -> std::string {
+#if defined(HERO_SHELL_HAVE_ZSTD)
+    if (encoder_ && !encoder_->Error().empty() && file_.Error().empty()) {
+      return file_.Path() + ": " + encoder_->Error();
+    }
+#endif
+    return file_.Error();
+  }
+  // Nullopt when the file is written uncompressed.
+  [[nodiscard]] auto Compression() const -> std::optional<CompressionStats> {
+#if defined(HERO_SHELL_HAVE_ZSTD)
+    if (encoder_) {
+      const auto stats = encoder_->GetStats();
+      return CompressionStats{stats.raw_bytes, stats.compressed_bytes, stats.busy};
+    }
+#endif
+    return std::nullopt;
+  }
+  [[nodiscard]] auto FramesWritten() const -> uint64_t {
+    return frames_written_.load(std::memory_order_relaxed);
+  }
+  [[nodiscard]] auto ChunksClosed() const -> uint32_t {
+    return chunks_closed_.load(std::memory_order_relaxed);
+  }
+  // full_waits counts frames that found the ring full and waited for the
+  // writer thread.
+  [[nodiscard]] auto Stats() const -> RingStats {
+    return {ring_.Size(), ring_.Capacity(), ring_.HighWater(),
+            full_waits_.load(std::memory_order_relaxed)};
+  }
+
+ private:
+  static constexpr std::chrono::microseconds kFullWait{100};
+  static constexpr std::chrono::microseconds kIdleWait{500};
+  static constexpr int kIdleSpins = 64;
+
+  void Run() {
+    int idle = 0;
+    bool poll_failed = false;
+    while (true) {
+      if (const auto* frame = ring_.Front()) {
+        if (RotationDue(frame->size()) && !CloseChunk()) {
+          on_error_(Error());
+        }
+        if (!chunk_open_ && !OpenChunk()) {
+          on_error_(Error());
+        } else if (Write(*frame)) {
+          ++chunk_frames_;
+          chunk_raw_bytes_ += frame->size();
+          frames_written_.fetch_add(1, std::memory_order_relaxed);
+          on_written_(*frame);
+        } else {
+          on_error_(Error());
+        }
+        ring_.Pop();
+        idle = 0;
+        continue;
+      }
+      if (stopping_.load(std::memory_order_acquire)) {
+        // The producer pushed its last frame before Stop; drain it.
+        if (!ring_.Front()) {
+          return;
+        }
+        continue;
+      }
+      if (++idle < kIdleSpins) {
+        std::this_thread::yield();
+        continue;
+      }
+      // A chunk whose time is up is closed even if no further frame comes.
+      if (chunk_frames_ > 0 && rotation_.interval.count() > 0 && RotationDue(0) &&
+          !CloseChunk()) {
+        on_error_(Error());
+      }
+      // A failing time-based flush is reported once, not on every idle pass.
+      if (!poll_failed && !file_.Poll()) {
+        poll_failed = true;
+        on_error_(file_.Error());
+      }
+      std::this_thread::sleep_for(kIdleWait);
+    }
+  }
+
+  auto Write(const absl::Cord& frame) -> bool {
+    for (const auto chunk : frame.Chunks()) {
+#if defined(HERO_SHELL_HAVE_ZSTD)
+      if (encoder_) {
+        if (!encoder_->Add(chunk.data(), chunk.size(), Sink())) {
+          return false;
+        }
+        continue;
+      }
+#endif
+      if (!file_.Append(chunk.data(), chunk.size())) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Whether the current chunk is complete before a frame of frame_bytes.
+  // Empty chunks are never closed for rotation.
+  [[nodiscard]] auto RotationDue(size_t frame_bytes) const -> bool {
+    if (!chunk_open_ || chunk_frames_ == 0 || !rotation_.Enabled()) {
+      return false;
+    }
+    return (rotation_.frames > 0 && chunk_frames_ >= rotation_.frames) ||
+           (rotation_.bytes > 0 && chunk_raw_bytes_ + frame_bytes > rotation_.bytes) ||
+           (rotation_.interval.count() > 0 &&
+            std::chrono::steady_clock::now() - chunk_started_ >= rotation_.interval);
+  }
+
+  // Opens chunk chunk_index_.
+  auto OpenChunk() -> bool {
+    chunk_frames_ = 0;
+    chunk_raw_bytes_ = 0;
+    chunk_started_ = std::chrono::steady_clock::now();
+    chunk_opened_ = std::chrono::system_clock::now();
+    if (!file_.Open(path_of_(chunk_index_))) {
+      return false;
+    }
+    chunk_open_ = true;
+    if (on_chunk_opened_) {
+      on_chunk_opened_(file_.Path());
+    }
+    return true;
+  }
+
+  // Completes, syncs and closes the current chunk and reports it; the next
+  // chunk gets the next index.
+  auto CloseChunk() -> bool {
+    chunk_open_ = false;
+    bool ok = true;
+#if defined(HERO_SHELL_HAVE_ZSTD)
+    if (encoder_ && !encoder_->Finish(Sink())) {
+      ok = false;
+    }
+#endif
+    const uint64_t file_bytes = file_.BytesWritten();
+    ok = file_.Close() && ok;
+    const uint32_t index = chunk_index_++;
+    if (!ok) {
+      return false;
+    }
+    chunks_closed_.fetch_add(1, std::memory_order_relaxed);
+    if (on_chunk_closed_) {
+      on_chunk_closed_({file_.Path(), index, chunk_frames_, chunk_raw_bytes_, file_bytes,
+                        chunk_opened_, std::chrono::system_clock::now()});
+    }
+    return true;
+  }
+
+#if defined(HERO_SHELL_HAVE_ZSTD)
+  auto Sink() -> SeekableZstdEncoder::Sink {
+    return [this](const char* data, size_t size) { return file_.Append(data, size); };
+  }
+#endif
+
+  FrameRing<absl::Cord> ring_;
+  BufferedFileWriter file_;
+#if defined(HERO_SHELL_HAVE_ZSTD)
+  std::unique_ptr<SeekableZstdEncoder> encoder_;
+#endif
+  OnWritten on_written_;
+  OnError on_error_;
+  // Chunk state, owned by the writer thread once it runs.
+  ChunkPath path_of_;
+  RotationPolicy rotation_;
+  OnChunkOpened on_chunk_opened_;
+  OnChunkClosed on_chunk_closed_;
+  bool chunk_open_ = false;
+  uint32_t chunk_index_ = 0;
+  uint64_t chunk_frames_ = 0;
+  uint64_t chunk_raw_bytes_ = 0;
+  std::chrono::steady_clock::time_point chunk_started_{};
+  std::chrono::system_clock::time_point chunk_opened_{};
+  std::atomic<uint32_t> chunks_closed_{0};
+  std::atomic<bool> stopping_{false};
+  std::atomic<uint64_t> frames_written_{0};
+  std::atomic<uint64_t> full_waits_{0};
+  std::thread worker_;
+};
@@ -0,0 +1,61 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// Sequence lock for a small trivially copyable value with rare writes and
+// frequent reads from other threads. Readers never block the writer and
+// never take a lock: they copy the value and retry if a write overlapped.
+//
+// The value is stored as relaxed atomic words, so a torn read is a retry, not
+// a data race. Store must not be called concurrently with itself; callers
+// serialize writers externally.
+template <typename T>
+class SeqLock {
+  static_assert(std::is_trivially_copyable_v<T>, "SeqLock needs a trivially copyable value");
+
+ public:
+  SeqLock() { Store(T{}); }
+  explicit SeqLock(const T& value) { Store(value); }
+
+  void Store(const T& value) {
+    std::array<uint64_t, kWords> words{};
+    std::memcpy(words.data(), &value, sizeof(T));
+    const uint64_t sequence = sequence_.load(std::memory_order_relaxed);
+    sequence_.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < kWords; ++i) {
+      words_[i].store(words[i], std::memory_order_relaxed);  // NOLINT
+    }
+    sequence_.store(sequence + 2, std::memory_order_release);
+  }
+
+  [[nodiscard]] auto Load() const -> T {
+    std::array<uint64_t, kWords> words{};
+    while (true) {
+      const uint64_t before = sequence_.load(std::memory_order_acquire);
+      if ((before & 1U) != 0) {
+        continue;
+      }
+      for (size_t i = 0; i < kWords; ++i) {
+        words[i] = words_[i].load(std::memory_order_relaxed);  // NOLINT
+      }
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (sequence_.load(std::memory_order_relaxed) == before) {
+        break;
+      }
+    }
+    T value;
+    std::memcpy(static_cast<void*>(&value), words.data(), sizeof(T));
+    return value;
+  }
+
+ private:
+  static constexpr size_t kWords = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+  std::atomic<uint64_t> sequence_{0};
+  std::array<std::atomic<uint64_t>, kWords> words_{};
+};
@@ -8,6 +8,7 @@
 #include <chrono>
 #include <cstdint>
 #include <functional>
+#include <limits>
 #include <stdexcept>
 #include <string>
 #include <string_view>
@@ -197,6 +198,34 @@ inline auto parse_duration(std::string_view sv) -> std::chrono::nanoseconds {
   return duration_cast<nanoseconds>(duration<double>(total_seconds));
 }
 
+// 例: "4096", "512K", "16M", "1G", "16MiB" (binary multiples)
+inline auto parse_size(std::string_view sv) -> std::uint64_t {
+  trim(sv);
+  std::size_t pos = 0;
+  while (pos < sv.size() && std::isdigit(static_cast<unsigned char>(sv[pos]))) pos++;
+  if (pos == 0) throw std::invalid_argument("size: missing numeric part");
+  if (pos > 15) throw std::out_of_range("size: value out of range");
+
+  const std::uint64_t value = std::stoull(std::string(sv.substr(0, pos)));
+  const std::string unit = to_lower(sv.substr(pos));
+  int shift = 0;
+  if (unit.empty() || unit == "b") {
+    shift = 0;
+  } else if (unit == "k" || unit == "kb" || unit == "kib") {
+    shift = 10;
+  } else if (unit == "m" || unit == "mb" || unit == "mib") {
+    shift = 20;
+  } else if (unit == "g" || unit == "gb" || unit == "gib") {
+    shift = 30;
+  } else {
+    throw std::invalid_argument("size: unknown unit '" + unit + "'");
+  }
+  if (value > (std::numeric_limits<std::uint64_t>::max() >> shift)) {
+    throw std::out_of_range("size: value out of range");
+  }
+  return value << shift;
+}
+
 inline auto parse_uint8(const std::string& s) -> int {
   size_t idx = 0;
   int base = 10;
@@ -0,0 +1,89 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// Throughput and per-message timing of one received stream.
+//
+//   read wait  from posting a read to its completion: time spent waiting for
+//              the next message, i.e. how far ahead of the data the receiver is
+//   handling   from a read's completion to the message being handed off;
+//              the receive thread's own cost per message
+struct StreamStats {
+  uint64_t messages = 0;
+  uint64_t bytes = 0;
+  std::chrono::nanoseconds elapsed{};  // first to last message
+  std::chrono::nanoseconds read_wait_mean{};
+  std::chrono::nanoseconds read_wait_max{};
+  std::chrono::nanoseconds handling_mean{};
+  std::chrono::nanoseconds handling_max{};
+
+  [[nodiscard]] auto BytesPerSecond() const -> double {
+    const double seconds = std::chrono::duration<double>(elapsed).count();
+    return seconds > 0.0 ? static_cast<double>(bytes) / seconds : 0.0;
+  }
+  [[nodiscard]] auto MessagesPerSecond() const -> double {
+    const double seconds = std::chrono::duration<double>(elapsed).count();
+    return seconds > 0.0 ? static_cast<double>(messages) / seconds : 0.0;
+  }
+};
+
+// Accumulates StreamStats. Record is called by the single receive thread;
+// Snapshot may be called from any thread and only reads relaxed atomics.
+class StreamMeter {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  void Record(size_t bytes, Clock::duration read_wait, Clock::duration handling) {
+    const auto now = Clock::now().time_since_epoch().count();
+    if (messages_.load(std::memory_order_relaxed) == 0) {
+      first_.store(now, std::memory_order_relaxed);
+    }
+    last_.store(now, std::memory_order_relaxed);
+    bytes_.fetch_add(bytes, std::memory_order_relaxed);
+    Add(read_wait_total_, read_wait_max_, read_wait);
+    Add(handling_total_, handling_max_, handling);
+    messages_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] auto Snapshot() const -> StreamStats {
+    StreamStats stats;
+    stats.messages = messages_.load(std::memory_order_relaxed);
+    stats.bytes = bytes_.load(std::memory_order_relaxed);
+    if (stats.messages == 0) {
+      return stats;
+    }
+    stats.elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::duration(
+        last_.load(std::memory_order_relaxed) - first_.load(std::memory_order_relaxed)));
+    const auto count = static_cast<int64_t>(stats.messages);
+    stats.read_wait_mean = Nanoseconds(read_wait_total_) / count;
+    stats.read_wait_max = Nanoseconds(read_wait_max_);
+    stats.handling_mean = Nanoseconds(handling_total_) / count;
+    stats.handling_max = Nanoseconds(handling_max_);
+    return stats;
+  }
+
+ private:
+  static void Add(std::atomic<int64_t>& total, std::atomic<int64_t>& max,
+                  Clock::duration value) {
+    const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(value).count();
+    total.fetch_add(ns, std::memory_order_relaxed);
+    if (ns > max.load(std::memory_order_relaxed)) {
+      max.store(ns, std::memory_order_relaxed);
+    }
+  }
+
+  static auto Nanoseconds(const std::atomic<int64_t>& value) -> std::chrono::nanoseconds {
+    return std::chrono::nanoseconds(value.load(std::memory_order_relaxed));
+  }
+
+  std::atomic<uint64_t> messages_{0};
+  std::atomic<uint64_t> bytes_{0};
+  std::atomic<Clock::rep> first_{0};
+  std::atomic<Clock::rep> last_{0};
+  std::atomic<int64_t> read_wait_total_{0};
+  std::atomic<int64_t> read_wait_max_{0};
+  std::atomic<int64_t> handling_total_{0};
+  std::atomic<int64_t> handling_max_{0};
+};
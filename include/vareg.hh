@@ -0,0 +1,306 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <istream>
+#include <iterator>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "base64.hh"
+#include "crc.hh"
+
+namespace shell::vareg {
+
+// One register field; arrays have count > 1. Order and widths follow the
+// bitstream, MSB first, exactly as scripts/vareg.py lays them out.
+struct FieldSpec {
+  std::string_view name;
+  uint8_t bits;
+  uint8_t count;
+};
+
+constexpr std::array<FieldSpec, 60> kFields = {{
+    {"disc3_bi", 3, 1},     {"Ioffset", 3, 1},     {"obi", 3, 1},
+    {"ibuf", 3, 1},         {"pre_bias", 3, 1},    {"sbi", 3, 1},
+    {"vrc", 3, 1},          {"ifsf", 3, 1},        {"ifss", 3, 1},
+    {"sha_bias", 3, 1},     {"twbi", 3, 1},        {"ck_bi", 4, 1},
+    {"Iramp", 4, 1},        {"ifp", 4, 1},         {"vth", 5, 1},
+    {"Pos_II_2", 1, 1},     {"Pos_II_1", 1, 1},    {"Shabi_lg", 1, 1},
+    {"Test_Enable", 1, 64}, {"Trim_Dac", 4, 64},   {"CH_Disable", 1, 64},
+    {"DTHR", 10, 1},        {"Dis_chan_CM", 1, 64}, {"Dis_chan_CMDummy", 1, 1},
+    {"Del_reg", 6, 64},     {"Del_reg_Dummy", 6, 1}, {"ADC_test2", 1, 1},
+    {"ADC_test1", 1, 1},    {"Ileak_offset", 1, 1}, {"Reserved6", 1, 1},
+    {"VA_RO", 1, 1},        {"ADC_on_b", 1, 1},    {"Reserved5", 1, 1},
+    {"negQ", 1, 1},         {"Low_gain", 1, 1},    {"Test_on", 1, 1},
+    {"CC_on", 1, 1},        {"Nside", 1, 1},       {"Slew_on_b", 1, 1},
+    {"Cal_gen_on", 1, 1},   {"Preb_hp", 1, 1},     {"Ck_en", 1, 1},
+    {"RO_all", 1, 1},       {"CM_thr_dis", 1, 1},  {"Iramp_f2", 1, 1},
+    {"Iramp_fb", 1, 1},     {"Reserved4", 1, 1},   {"Reserved3", 1, 1},
+    {"Reserved2", 1, 1},    {"Reserved1", 1, 1},   {"All2", 1, 1},
+    {"Cal_HDR", 1, 1},      {"Cal_HDR2", 1, 1},    {"C_cal6", 1, 1},
+    {"C_cal5", 1, 1},       {"C_cal4", 1, 1},      {"C_cal3", 1, 1},
+    {"C_cal2", 1, 1},       {"C_cal1", 1, 1},      {"C_cal0", 1, 1},
+}};
+
+constexpr auto total_values() -> size_t {
+  size_t total = 0;
+  for (const auto& field : kFields) {
+    total += field.count;
+  }
+  return total;
+}
+
+constexpr auto total_bits() -> size_t {
+  size_t total = 0;
+  for (const auto& field : kFields) {
+    total += static_cast<size_t>(field.bits) * field.count;
+  }
+  return total;
+}
+
+static_assert(total_bits() == 936, "VAREG field table does not match the 936-bit layout");
+
+// The settings of one VA ASIC: a 128-byte image, of which the fields use the
+// leading 936 bits. The remaining bits are written as zero.
+class Vareg {
+ public:
+  static constexpr size_t kBytes = 128;
+
+  [[nodiscard]] auto Get(std::string_view name, size_t index = 0) const -> uint32_t {
+    const auto [offset, field] = Locate(name, index);
+    (void)field;
+    return values_[offset];  // NOLINT
+  }
+
+  void Set(std::string_view name, size_t index, uint32_t value) {
+    const auto [offset, field] = Locate(name, index);
+    if (value >= (1U << field->bits)) {
+      throw std::out_of_range(std::to_string(value) + " exceeds " + std::to_string(field->bits) +
+                              " bits of " + std::string(name));
+    }
+    values_[offset] = value;  // NOLINT
+  }
+
+  void Set(std::string_view name, uint32_t value) { Set(name, 0, value); }
+
+  [[nodiscard]] auto ToBytes() const -> std::array<uint8_t, kBytes> {
+    std::array<uint8_t, kBytes> out{};
+    size_t bit_pos = 0;
+    size_t offset = 0;
+    for (const auto& field : kFields) {
+      // Arrays are stored highest index first.
+      for (size_t i = field.count; i-- > 0;) {
+        WriteBits(out, bit_pos, field.bits, values_[offset + i]);  // NOLINT
+        bit_pos += field.bits;
+      }
+      offset += field.count;
+    }
+    return out;
+  }
+
+  static auto FromBytes(const uint8_t* data) -> Vareg {
+    Vareg vareg;
+    size_t bit_pos = 0;
+    size_t offset = 0;
+    for (const auto& field : kFields) {
+      for (size_t i = field.count; i-- > 0;) {
+        vareg.values_[offset + i] = ReadBits(data, bit_pos, field.bits);  // NOLINT
+        bit_pos += field.bits;
+      }
+      offset += field.count;
+    }
+    return vareg;
+  }
+
+ private:
+  static auto Locate(std::string_view name, size_t index) -> std::pair<size_t, const FieldSpec*> {
+    size_t offset = 0;
+    for (const auto& field : kFields) {
+      if (field.count > 0 && field.name == name) {
+        if (index >= field.count) {
+          throw std::out_of_range("Index " + std::to_string(index) + " out of range for " +
+                                  std::string(name));
+        }
+        return {offset + index, &field};
+      }
+      offset += field.count;
+    }
+    throw std::invalid_argument("Unknown VAREG field " + std::string(name));
+  }
+
+  static void WriteBits(std::array<uint8_t, kBytes>& out, size_t bit_pos, size_t bits,
+                        uint32_t value) {
+    for (size_t i = 0; i < bits; ++i) {
+      if ((value >> (bits - 1 - i)) & 1U) {
+        const size_t position = bit_pos + i;
+        out[position / 8] |= static_cast<uint8_t>(1U << (7 - position % 8));  // NOLINT
+      }
+    }
+  }
+
+  static auto ReadBits(const uint8_t* data, size_t bit_pos, size_t bits) -> uint32_t {
+    uint32_t value = 0;
+    for (size_t i = 0; i < bits; ++i) {
+      const size_t position = bit_pos + i;
+      value = (value << 1) | ((data[position / 8] >> (7 - position % 8)) & 1U);  // NOLINT
+    }
+    return value;
+  }
+
+  std::array<uint32_t, total_values()> values_{};
+};
+
+// The four-ASIC image uploaded by set_vareg: ASIC 3 first, then a big-endian
+// CRC32 of the 512 data bytes, base64 encoded on disk.
+class Vareg4ASIC {
+ public:
+  static constexpr size_t kAsicCount = 4;
+  static constexpr size_t kDataBytes = Vareg::kBytes * kAsicCount;
+  static constexpr size_t kImageBytes = kDataBytes + 4;
+
+  std::array<Vareg, kAsicCount> asics{};
+
+  [[nodiscard]] auto ToBytes() const -> std::vector<uint8_t> {
+    std::vector<uint8_t> out;
+    out.reserve(kImageBytes);
+    for (size_t asic = kAsicCount; asic-- > 0;) {
+      const auto bytes = asics[asic].ToBytes();  // NOLINT
+      out.insert(out.end(), bytes.begin(), bytes.end());
+    }
+    return out;
+  }
+
+  static auto FromBytes(const std::vector<uint8_t>& data) -> Vareg4ASIC {
+    if (data.size() != kDataBytes) {
+      throw std::invalid_argument("VAREG data must be " + std::to_string(kDataBytes) + " bytes");
+    }
+    Vareg4ASIC vareg;
+    for (size_t i = 0; i < kAsicCount; ++i) {
+      vareg.asics[kAsicCount - 1 - i] = Vareg::FromBytes(data.data() + i * Vareg::kBytes);  // NOLINT
+    }
+    return vareg;
+  }
+
+  [[nodiscard]] auto ToBase64() const -> std::string {
+    auto data = ToBytes();
+    const auto crc = shell::crc::crc32(data.data(), data.size());
+    for (int shift = 24; shift >= 0; shift -= 8) {
+      data.push_back(static_cast<uint8_t>((crc >> shift) & 0xFFu));
+    }
+    return shell::base64::base64_encode(data);
+  }
+
+  static auto FromBase64(const std::string& text, bool check = true) -> Vareg4ASIC {
+    auto data = shell::base64::base64_decode(text);
+    if (data.size() != kImageBytes) {
+      throw std::invalid_argument("VAREG image must be " + std::to_string(kImageBytes) +
+                                  " bytes after base64 decoding, but got " +
+                                  std::to_string(data.size()));
+    }
+    if (check) {
+      const uint32_t expected = static_cast<uint32_t>(data[kDataBytes]) << 24 |
+                                static_cast<uint32_t>(data[kDataBytes + 1]) << 16 |
+                                static_cast<uint32_t>(data[kDataBytes + 2]) << 8 |
+                                static_cast<uint32_t>(data[kDataBytes + 3]);
+      if (shell::crc::crc32(data.data(), kDataBytes) != expected) {
+        throw std::invalid_argument("VAREG CRC32 mismatch");
+      }
+    }
+    data.resize(kDataBytes);
+    return FromBytes(data);
+  }
+
+  static auto Load(const std::string& filename, bool check = true) -> Vareg4ASIC {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file) {
+      throw std::runtime_error("Could not open VAREG file " + filename);
+    }
+    return FromBase64(
+        std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()),
+        check);
+  }
+
+  void Save(const std::string& filename) const {
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    if (!file) {
+      throw std::runtime_error("Could not open VAREG file " + filename);
+    }
+    file << ToBase64();
+    if (!file.good()) {
+      throw std::runtime_error("Could not write VAREG file " + filename);
+    }
+  }
+};
+
+// Aligns every channel to its ASIC's highest pedestal through Del_reg.
+// The measured medians already include the current Del_reg, so it is removed
+// first; the new value is the distance to the highest reconstructed pedestal,
+// rounded half to even and clamped to 0..63 (the set_delreg.py behavior).
+inline void trim_del_reg(Vareg4ASIC& vareg,
+                         const std::array<std::array<double, 64>, Vareg4ASIC::kAsicCount>&
+                             pedestals) {
+  for (size_t asic = 0; asic < Vareg4ASIC::kAsicCount; ++asic) {
+    auto& registers = vareg.asics[asic];  // NOLINT
+    std::array<double, 64> untrimmed{};
+    for (size_t channel = 0; channel < untrimmed.size(); ++channel) {
+      untrimmed[channel] = pedestals[asic][channel] -  // NOLINT
+                           static_cast<double>(registers.Get("Del_reg", channel));
+    }
+    const double highest = *std::max_element(untrimmed.begin(), untrimmed.end());
+    for (size_t channel = 0; channel < untrimmed.size(); ++channel) {
+      const double trim = std::clamp(std::nearbyint(highest - untrimmed[channel]), 0.0, 63.0);
+      registers.Set("Del_reg", channel, static_cast<uint32_t>(trim));
+    }
+  }
+}
+
+// Sets CH_Disable for every channel of a calc_pedestal/raw2root channel map
+// ("<asic> <channel> <status> ..." per line, '#' comments) whose status is in
+// statuses; the other channels keep their current bit. The map must list all
+// 256 channels. Returns the number of channels it disabled.
+inline auto apply_channel_map(Vareg4ASIC& vareg, std::istream& channel_map,
+                              const std::set<std::string>& statuses) -> size_t {
+  constexpr size_t kChannels = 64;
+  size_t seen = 0;
+  size_t disabled = 0;
+  std::string line;
+  while (std::getline(channel_map, line)) {
+    std::istringstream fields(line);
+    std::string first;
+    if (!(fields >> first) || first[0] == '#') {
+      continue;
+    }
+    size_t asic = 0;
+    size_t channel = 0;
+    std::string status;
+    try {
+      asic = std::stoul(first);
+    } catch (const std::exception&) {
+      throw std::invalid_argument("Malformed channel map line: " + line);
+    }
+    if (!(fields >> channel >> status) || asic >= Vareg4ASIC::kAsicCount ||
+        channel >= kChannels) {
+      throw std::invalid_argument("Malformed channel map line: " + line);
+    }
+    ++seen;
+    if (statuses.count(status) != 0) {
+      vareg.asics[asic].Set("CH_Disable", channel, 1);  // NOLINT
+      ++disabled;
+    }
+  }
+  if (seen != Vareg4ASIC::kAsicCount * kChannels) {
+    throw std::invalid_argument("Expected " + std::to_string(Vareg4ASIC::kAsicCount * kChannels) +
+                                " channels in the channel map, got " + std::to_string(seen));
+  }
+  return disabled;
+}
+
+}  // namespace shell::vareg
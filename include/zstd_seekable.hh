@@ -0,0 +1,152 @@
+#pragma once
+#include <zstd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Streaming encoder for the zstd seekable format: the input is cut into
+// chunks of chunk_bytes, each compressed as an independent zstd frame, and
+// Finish appends the seek table, a skippable frame listing every frame's
+// compressed and decompressed size. Any zstd decoder reads the result as a
+// plain .zst file (the table is skipped); seekable readers jump straight to
+// the frame holding a given raw offset.
+//
+// Stats may be read from any thread while another thread encodes.
+class SeekableZstdEncoder {
+ public:
+  // Receives compressed bytes in file order; false aborts the encoding.
+  using Sink = std::function<bool(const char* data, size_t size)>;
+
+  struct Stats {
+    uint64_t raw_bytes = 0;
+    uint64_t compressed_bytes = 0;
+    std::chrono::nanoseconds busy{};  // time spent inside the compressor
+  };
+
+  SeekableZstdEncoder(int level, int threads, size_t chunk_bytes)
+      : context_(ZSTD_createCCtx()), chunk_bytes_(chunk_bytes) {
+    raw_.reserve(chunk_bytes);
+    compressed_.resize(ZSTD_compressBound(chunk_bytes));
+    if (!context_) {
+      error_ = "cannot create zstd context";
+      return;
+    }
+    ZSTD_CCtx_setParameter(context_.get(), ZSTD_c_compressionLevel, level);
+    ZSTD_CCtx_setParameter(context_.get(), ZSTD_c_checksumFlag, 1);
+    if (threads > 0) {
+      // Fails harmlessly when libzstd was built without multithreading.
+      ZSTD_CCtx_setParameter(context_.get(), ZSTD_c_nbWorkers, threads);
+    }
+  }
+
+  [[nodiscard]] auto Error() const -> const std::string& { return error_; }
+
+  auto Add(const char* data, size_t size, const Sink& sink) -> bool {
+    if (!error_.empty()) {
+      return false;
+    }
+    while (size > 0) {
+      const size_t chunk = std::min(size, chunk_bytes_ - raw_.size());
+      raw_.insert(raw_.end(), data, data + chunk);  // NOLINT
+      data += chunk;                                // NOLINT
+      size -= chunk;
+      if (raw_.size() == chunk_bytes_ && !CompressChunk(sink)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Compresses what is left and writes the seek table. Further Adds start a
+  // new seekable stream, e.g. in the next output file.
+  auto Finish(const Sink& sink) -> bool {
+    if (!error_.empty() || (!raw_.empty() && !CompressChunk(sink))) {
+      return false;
+    }
+    std::vector<char> table;
+    const auto entries = static_cast<uint32_t>(entries_.size());
+    const uint32_t content_bytes = entries * 8 + kFooterBytes;
+    PutLe32(table, kSkippableMagic);
+    PutLe32(table, content_bytes);
+    for (const auto& entry : entries_) {
+      PutLe32(table, entry.compressed);
+      PutLe32(table, entry.raw);
+    }
+    PutLe32(table, entries);
+    table.push_back(0);  // descriptor: no per-frame checksums
+    PutLe32(table, kSeekableMagic);
+    entries_.clear();
+    if (!sink(table.data(), table.size())) {
+      error_ = "cannot write seek table";
+      return false;
+    }
+    compressed_bytes_.fetch_add(table.size(), std::memory_order_relaxed);
+    return true;
+  }
+
+  [[nodiscard]] auto GetStats() const -> Stats {
+    return {raw_bytes_.load(std::memory_order_relaxed),
+            compressed_bytes_.load(std::memory_order_relaxed),
+            std::chrono::nanoseconds(busy_ns_.load(std::memory_order_relaxed))};
+  }
+
+ private:
+  static constexpr uint32_t kSkippableMagic = 0x184D2A5E;
+  static constexpr uint32_t kSeekableMagic = 0x8F92EAB1;
+  static constexpr uint32_t kFooterBytes = 9;
+
+  struct Entry {
+    uint32_t compressed = 0;
+    uint32_t raw = 0;
+  };
+
+  struct ContextDeleter {
+    void operator()(ZSTD_CCtx* context) const { ZSTD_freeCCtx(context); }
+  };
+
+  static void PutLe32(std::vector<char>& out, uint32_t value) {
+    for (int shift = 0; shift < 32; shift += 8) {
+      out.push_back(static_cast<char>((value >> shift) & 0xFFU));
+    }
+  }
+
+  auto CompressChunk(const Sink& sink) -> bool {
+    const auto start = std::chrono::steady_clock::now();
+    const size_t size = ZSTD_compress2(context_.get(), compressed_.data(), compressed_.size(),
+                                       raw_.data(), raw_.size());
+    busy_ns_.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           std::chrono::steady_clock::now() - start)
+                           .count(),
+                       std::memory_order_relaxed);
+    if (ZSTD_isError(size) != 0) {
+      error_ = std::string("zstd: ") + ZSTD_getErrorName(size);
+      return false;
+    }
+    if (!sink(compressed_.data(), size)) {
+      error_ = "cannot write compressed frame";
+      return false;
+    }
+    entries_.push_back({static_cast<uint32_t>(size), static_cast<uint32_t>(raw_.size())});
+    raw_bytes_.fetch_add(raw_.size(), std::memory_order_relaxed);
+    compressed_bytes_.fetch_add(size, std::memory_order_relaxed);
+    raw_.clear();
+    return true;
+  }
+
+  std::unique_ptr<ZSTD_CCtx, ContextDeleter> context_;
+  size_t chunk_bytes_ = 0;
+  std::vector<char> raw_;
+  std::vector<char> compressed_;
+  std::vector<Entry> entries_;
+  std::string error_;
+  std::atomic<uint64_t> raw_bytes_{0};
+  std::atomic<uint64_t> compressed_bytes_{0};
+  std::atomic<int64_t> busy_ns_{0};
+};
@@ -1,75 +1,149 @@
 #include <algorithm>
-#include <array>
-#include <cstddef>
-#include <cstdint>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <map>
+#include <memory>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <vector>
 
-#include "detector_constants.hh"
-#include "frame_analyzer.hh"
-#include "raw_data_file.hh"
+#include "channel_stats_sink.hh"
+#include "common_mode.hh"
+#include "pedestal_run.hh"
+#include "pedestal_sink.hh"
+#include "progress_bar.hh"
 
 namespace {
 
-constexpr size_t kMaxEvents = 8192;
-using PedestalSamples =
-    std::array<std::array<std::vector<int16_t>, kChannelNum>, kAsicNum>;
-
-auto median(std::vector<int16_t>& samples) -> double {
-  if (samples.empty()) {
-    throw std::runtime_error("No pedestal samples for one or more channels");
-  }
-
-  const auto middle = samples.begin() + static_cast<std::ptrdiff_t>(samples.size() / 2U);
-  std::nth_element(samples.begin(), middle, samples.end());
-  if (samples.size() % 2U != 0) {
-    return *middle;
-  }
-  const auto lower = std::max_element(samples.begin(), middle);
-  return (static_cast<double>(*lower) + *middle) / 2.0;
+void print_usage(const std::string& program) {
+  std::cerr << "Usage: " << program
+            << " [--max-events N] [--jobs N] [--output PREFIX] [--common-mode METHOD]\n"
+            << "       [--channel-map PREFIX [--noisy-factor F] [--hot-factor F]] input...\n"
+            << "  input is a raw file or a run prefix (every <prefix>_0xNN file\n"
+            << "  or <prefix>_0xNN_NNNNNN chunk).\n"
+            << "  Files are grouped by their _0xNN logical address and each detector is\n"
+            << "  processed on its own thread. One detector without --output prints the\n"
+            << "  plain 4x64 table; otherwise each table is preceded by 'address 0xNN'.\n"
+            << "  --output PREFIX writes PREFIX_0xNN.pedestal per detector instead.\n"
+            << "  --common-mode hardware|median|mean selects the CMN subtracted from ADC:\n"
+            << "  the ASIC's CMN word (default), or the per-event median or truncated\n"
+            << "  mean of the ASIC's flagged channels.\n"
+            << "  --channel-map PREFIX also writes PREFIX_0xNN.channels per detector:\n"
+            << "  hits, occupancy, median, MAD, mean, sigma and a dead/stuck/noisy/hot\n"
+            << "  status per channel, from the same pass. A channel is noisy (hot) when\n"
+            << "  its sigma (occupancy) exceeds the factor times its ASIC's median\n"
+            << "  (default " << ChannelStatsSink::kDefaultNoisyFactor << " and "
+            << ChannelStatsSink::kDefaultHotFactor << ").\n";
 }
 
 }  // namespace
 
 auto main(int argc, char** argv) -> int try {
-  if (argc == 2 && std::string(argv[1]) == "--check") {
+  const std::vector<std::string> args(argv, argv + argc);  // NOLINT
+  if (args.size() == 2 && args[1] == "--check") {
     return 0;
   }
-  if (argc != 2) {
-    std::cerr << "Usage: " << argv[0] << " raw_file\n";
+
+  size_t max_events = PedestalSink::kUnlimited;
+  size_t jobs = std::max(1U, std::thread::hardware_concurrency());
+  std::string output_prefix;
+  std::string channel_map_prefix;
+  double noisy_factor = ChannelStatsSink::kDefaultNoisyFactor;
+  double hot_factor = ChannelStatsSink::kDefaultHotFactor;
+  CommonModeMethod common_mode = CommonModeMethod::kHardware;
+  std::vector<std::string> inputs;
+  for (size_t i = 1; i < args.size(); ++i) {
+    if (args[i] == "--max-events" && i + 1 < args.size()) {
+      max_events = std::stoull(args[++i]);
+    } else if (args[i] == "--jobs" && i + 1 < args.size()) {
+      jobs = std::max<size_t>(1, std::stoull(args[++i]));
+    } else if (args[i] == "--output" && i + 1 < args.size()) {
+      output_prefix = args[++i];
+    } else if (args[i] == "--channel-map" && i + 1 < args.size()) {
+      channel_map_prefix = args[++i];
+    } else if (args[i] == "--noisy-factor" && i + 1 < args.size()) {
+      noisy_factor = std::stod(args[++i]);
+    } else if (args[i] == "--hot-factor" && i + 1 < args.size()) {
+      hot_factor = std::stod(args[++i]);
+    } else if (args[i] == "--common-mode" && i + 1 < args.size()) {
+      common_mode = parse_common_mode(args[++i]);
+    } else if (args[i].rfind("--", 0) != 0) {
+      inputs.push_back(args[i]);
+    } else {
+      print_usage(args.front());
+      return 1;
+    }
+  }
+  if (inputs.empty()) {
+    print_usage(args.front());
     return 1;
   }
 
-  PedestalSamples samples;
-  RawDataFile raw(argv[1], false);
-  cdtedsd::EventData<kAsicNum, kChannelNum> event{};
-  cdtedsd::FrameAnalyzer<kAsicNum, kChannelNum> analyzer{};
-  size_t event_count = 0;
+  std::map<std::string, std::vector<std::string>> files_by_key;
+  for (const auto& input : inputs) {
+    for (const auto& file : expand_run_input(input)) {
+      files_by_key[detector_key(file)].push_back(file);
+    }
+  }
+  const CommonModeEstimator estimator(common_mode);
+  std::vector<DetectorPedestal> detectors;
+  for (auto& [key, files] : files_by_key) {
+    detectors.push_back({key, std::move(files), nullptr, "", nullptr});
+    if (!channel_map_prefix.empty()) {
+      detectors.back().stats =
+          std::make_unique<ChannelStatsSink>(max_events, noisy_factor, hot_factor, estimator);
+    }
+  }
+  // Progress goes to stderr, where it cannot mix with a printed table.
+  uint64_t total_bytes = 0;
+  for (const auto& detector : detectors) {
+    for (const auto& file : detector.files) {
+      std::error_code error;
+      const auto size = std::filesystem::file_size(file, error);
+      total_bytes += error ? 0 : static_cast<uint64_t>(size);
+    }
+  }
+  ProgressBar progress(total_bytes, std::cerr, STDERR_FILENO);
+  compute_pedestals(detectors, max_events, jobs, estimator, nullptr, &progress);
+  progress.Finish();
 
-  while (event_count < kMaxEvents && raw.GetNextFrame()) {
-    const auto& frame = raw.GetFrame();
-    analyzer.Initialize(reinterpret_cast<const uint8_t*>(frame.data()), frame.size());
-    while (event_count < kMaxEvents && analyzer.UnpackNextEvent(event)) {
-      if (!event.valid) {
-        continue;
-      }
-      ++event_count;
-      for (size_t asic = 0; asic < kAsicNum; ++asic) {
-        const auto& data = event.asic_data[asic];
-        for (size_t channel = 0; channel < kChannelNum; ++channel) {
-          if (data.chflag.test(channel)) {
-            samples[asic][channel].push_back(data.adc_data[channel] - data.cmn);
-          }
-        }
-      }
+  bool ok = true;
+  for (const auto& detector : detectors) {
+    if (!detector.error.empty()) {
+      std::cerr << "Error: " << detector.key << ": " << detector.error << "\n";
+      ok = false;
     }
   }
+  if (!ok) {
+    return 1;
+  }
 
-  for (auto& asic : samples) {
-    for (size_t channel = 0; channel < asic.size(); ++channel) {
-      std::cout << median(asic[channel]) << (channel + 1U == asic.size() ? '\n' : ' ');
+  for (const auto& detector : detectors) {
+    if (detector.stats) {
+      const std::string path = channel_map_prefix + "_" + detector.key + ".channels";
+      std::ofstream output(path);
+      if (!output.is_open()) {
+        throw std::runtime_error("Could not open output file " + path);
+      }
+      detector.stats->WriteMap(output);
+      std::cerr << detector.key << ": channel map -> " << path << "\n";
+    }
+    if (!output_prefix.empty()) {
+      const std::string path = output_prefix + "_" + detector.key + ".pedestal";
+      std::ofstream output(path);
+      if (!output.is_open()) {
+        throw std::runtime_error("Could not open output file " + path);
+      }
+      detector.pedestal->WriteTable(output);
+      std::cerr << detector.key << ": " << detector.pedestal->EventCount() << " events -> "
+                << path << "\n";
+    } else if (detectors.size() == 1) {
+      detector.pedestal->WriteTable(std::cout);
+    } else {
+      std::cout << "address " << detector.key << "\n";
+      detector.pedestal->WriteTable(std::cout);
     }
   }
   return 0;
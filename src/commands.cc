@@ -31,16 +31,28 @@
 #include <memory>
 #include <mutex>
 #include <optional>
+#include <set>
 #include <sstream>
 #include <string>
 #include <thread>
 #include <vector>
 
 #include "base64.hh"
+#include "conversion_pool.hh"
 #include "crc.hh"
+#include "event_continuity.hh"
+#include "frame_tap.hh"
+#include "hk_monitor.hh"
 #include "grpc_funcs.hh"
 #include "hero_shell_state.hh"
+#include "online_pedestal.hh"
+#include "pedestal_run.hh"
+#include "quick_look.hh"
+#include "readout_writer.hh"
+#include "seqlock.hh"
 #include "shell_utils.hh"
+#include "stream_meter.hh"
+#include "vareg.hh"
 
 using std::string;
 using namespace std::chrono;
@@ -86,16 +98,72 @@ auto trim_copy(const std::string& input) -> std::string {
 }
 
 std::string g_last_set_vareg_path = "N/A";
+// Last VAREG file accepted per logical address, the pedcalib_readout baseline.
+std::map<uint8_t, std::string> g_set_vareg_paths;
+
+// Timing read by the prompt every redraw. It lives in a seqlock rather than
+// under g_readout_status_mutex, so the prompt never copies or locks the full
+// status.
+struct ReadoutTiming {
+  std::chrono::nanoseconds duration{};
+  std::chrono::steady_clock::time_point start_time{};
+  bool started = false;
+};
+
+// One frame counter per logical address, each on its own cache line, so the
+// writer threads count frames without a lock and without sharing lines.
+struct alignas(64) ReadoutFrameCounter {
+  std::atomic<uint64_t> frames{0};
+};
+
+// One output writer ("0xNN" or "HK") as shown by readout status.
+struct ReadoutWriterStats {
+  RingStats ring;
+  std::optional<CompressionStats> compression;
+  uint32_t chunks = 0;  // completed chunks of a rotated output
+};
+
+// Writer and DataStream receive statistics, rebuilt once a second and once
+// more after the files are closed. Each refresh publishes a new immutable
+// snapshot, so readout status shares it instead of copying it under a lock.
+struct ReadoutTransferStats {
+  std::map<std::string, ReadoutWriterStats> writers;
+  // One DataStream per endpoint; the name is empty when only one streams.
+  std::vector<std::pair<std::string, StreamStats>> streams;
+  bool rotating = false;
+};
+
+// Background raw2root conversion counts, refreshed up to ten times a second.
+struct ReadoutConversions {
+  ConversionStats stats;
+  bool enabled = false;
+};
 
 struct ReadoutStatus {
+  // duration, start_time, started and frame_counters are filled in by
+  // readout_status_snapshot from g_readout_timing and g_readout_frames.
   std::chrono::nanoseconds duration{};
   std::chrono::steady_clock::time_point start_time{};
   std::map<uint8_t, size_t> frame_counters;
+  // Filled in from g_readout_continuity, like frame_counters.
+  std::map<uint8_t, EventContinuity::Stats> continuity;
+  std::vector<uint8_t> detector_addresses;
   std::vector<std::string> messages;
   std::string job_name = "readout";
   std::string file_prefix;
-  std::string hk_filename;
+  std::map<std::string, std::string> hk_filenames;  // by output, "HK" or "HK/<endpoint>"
   std::string register_filename;
+  // Live pedestal accumulation of pedcalib_readout; kept after the run ends.
+  std::shared_ptr<const OnlinePedestal> online_pedestal;
+  // Quick-look histograms of readout quicklook=; kept after the run ends.
+  std::shared_ptr<const QuickLook> quick_look;
+  // Latest decoded HK values per logical address; kept after the run ends.
+  std::shared_ptr<const HkMonitor> hk_monitor;
+  // Filled in from g_readout_transfer; never null in a snapshot.
+  std::shared_ptr<const ReadoutTransferStats> transfer;
+  // Background raw2root conversions, when enabled; kept after the run ends.
+  // Filled in from g_readout_conversions.
+  std::optional<ConversionStats> conversions;
   size_t suppressed_message_count = 0;
   bool started = false;
   bool has_result = false;
@@ -105,30 +173,50 @@ struct ReadoutStatus {
 
 std::mutex g_readout_status_mutex;
 ReadoutStatus g_readout_status;
+// Written only with g_readout_status_mutex held; read without it.
+SeqLock<ReadoutTiming> g_readout_timing;
+std::array<ReadoutFrameCounter, 256> g_readout_frames;
+// Event continuity per logical address, stored by its writer thread after
+// every frame and read by readout status without a lock.
+std::array<SeqLock<EventContinuity::Stats>, 256> g_readout_continuity;
+// Published by the readout thread; only accessed through std::atomic_load
+// and std::atomic_store.
+std::shared_ptr<const ReadoutTransferStats> g_readout_transfer;
+// Written only by the readout thread; read without a lock.
+SeqLock<ReadoutConversions> g_readout_conversions;
 constexpr size_t kMaxReadoutMessages = 20;
 
 void reset_readout_status(std::chrono::nanoseconds duration,
                           const std::string& job_name = "readout") {
   std::lock_guard<std::mutex> lock(g_readout_status_mutex);
   g_readout_status = {};
-  g_readout_status.duration = duration;
   g_readout_status.job_name = job_name;
+  g_readout_timing.Store({duration, {}, false});
+  for (auto& counter : g_readout_frames) {
+    counter.frames.store(0, std::memory_order_relaxed);
+  }
+  for (auto& continuity : g_readout_continuity) {
+    continuity.Store({});
+  }
+  std::atomic_store(&g_readout_transfer, std::shared_ptr<const ReadoutTransferStats>());
+  g_readout_conversions.Store({});
 }
 
 void mark_readout_started() {
   std::lock_guard<std::mutex> lock(g_readout_status_mutex);
-  g_readout_status.start_time = std::chrono::steady_clock::now();
-  g_readout_status.started = true;
+  auto timing = g_readout_timing.Load();
+  timing.start_time = std::chrono::steady_clock::now();
+  timing.started = true;
+  g_readout_timing.Store(timing);
 }
 
-void set_readout_outputs(const std::string& file_prefix, const std::string& hk_filename,
+void set_readout_outputs(const std::string& file_prefix,
+                         std::map<std::string, std::string> hk_filenames,
                          const std::vector<uint8_t>& detector_addresses) {
   std::lock_guard<std::mutex> lock(g_readout_status_mutex);
   g_readout_status.file_prefix = file_prefix;
-  g_readout_status.hk_filename = hk_filename;
-  for (const auto address : detector_addresses) {
-    g_readout_status.frame_counters.try_emplace(address, 0);
-  }
+  g_readout_status.hk_filenames = std::move(hk_filenames);
+  g_readout_status.detector_addresses = detector_addresses;
 }
 
 void set_readout_register_output(const std::string& register_filename) {
@@ -136,6 +224,21 @@ void set_readout_register_output(const std::string& register_filename) {
   g_readout_status.register_filename = register_filename;
 }
 
+void set_readout_online_pedestal(std::shared_ptr<const OnlinePedestal> online_pedestal) {
+  std::lock_guard<std::mutex> lock(g_readout_status_mutex);
+  g_readout_status.online_pedestal = std::move(online_pedestal);
+}
+
+void set_readout_quick_look(std::shared_ptr<const QuickLook> quick_look) {
+  std::lock_guard<std::mutex> lock(g_readout_status_mutex);
+  g_readout_status.quick_look = std::move(quick_look);
+}
+
+void set_readout_hk_monitor(std::shared_ptr<const HkMonitor> hk_monitor) {
+  std::lock_guard<std::mutex> lock(g_readout_status_mutex);
+  g_readout_status.hk_monitor = std::move(hk_monitor);
+}
+
 void record_readout_message(const std::string& message) {
   std::lock_guard<std::mutex> lock(g_readout_status_mutex);
   if (g_readout_status.messages.size() < kMaxReadoutMessages) {
@@ -145,9 +248,20 @@ void record_readout_message(const std::string& message) {
   }
 }
 
+void set_readout_writer_stats(std::map<std::string, ReadoutWriterStats> writers,
+                              std::vector<std::pair<std::string, StreamStats>> streams,
+                              bool rotating) {
+  std::shared_ptr<const ReadoutTransferStats> transfer = std::make_shared<ReadoutTransferStats>(
+      ReadoutTransferStats{std::move(writers), std::move(streams), rotating});
+  std::atomic_store(&g_readout_transfer, std::move(transfer));
+}
+
+void set_readout_conversion_stats(const ConversionStats& conversions) {
+  g_readout_conversions.Store({conversions, true});
+}
+
 void increment_readout_frame_count(uint8_t logical_address) {
-  std::lock_guard<std::mutex> lock(g_readout_status_mutex);
-  g_readout_status.frame_counters[logical_address] += 1;
+  g_readout_frames[logical_address].frames.fetch_add(1, std::memory_order_relaxed);
 }
 
 void finish_readout_status(bool succeeded, bool stop_requested) {
@@ -158,8 +272,148 @@ void finish_readout_status(bool succeeded, bool stop_requested) {
 }
 
 auto readout_status_snapshot() -> ReadoutStatus {
+  ReadoutStatus status;
+  {
+    std::lock_guard<std::mutex> lock(g_readout_status_mutex);
+    status = g_readout_status;
+  }
+  status.transfer = std::atomic_load(&g_readout_transfer);
+  if (!status.transfer) {
+    status.transfer = std::make_shared<const ReadoutTransferStats>();
+  }
+  if (const auto conversions = g_readout_conversions.Load(); conversions.enabled) {
+    status.conversions = conversions.stats;
+  }
+  const auto timing = g_readout_timing.Load();
+  status.duration = timing.duration;
+  status.start_time = timing.start_time;
+  status.started = timing.started;
+  for (const auto address : status.detector_addresses) {
+    status.frame_counters[address] =
+        g_readout_frames[address].frames.load(std::memory_order_relaxed);
+    status.continuity[address] = g_readout_continuity[address].Load();
+  }
+  return status;
+}
+
+// The quick-look histograms alone, without snapshotting the rest of the status.
+auto readout_quick_look() -> std::shared_ptr<const QuickLook> {
   std::lock_guard<std::mutex> lock(g_readout_status_mutex);
-  return g_readout_status;
+  return g_readout_status.quick_look;
+}
+
+// "lost ~120 events in 3 gaps | 1 out of order | 2 time gaps, max ti step 48211 | 0 unparsed",
+// with restarts only once the event counter restarted.
+auto format_continuity(const EventContinuity::Stats& stats) -> std::string {
+  std::ostringstream out;
+  out << "lost ~" << stats.lost_events << " events in " << stats.gaps << " gaps | "
+      << stats.out_of_order << " out of order | ";
+  if (stats.restarts > 0) {
+    out << stats.restarts << " counter restarts | ";
+  }
+  out << stats.time_gaps << " time gaps, max ti step " << stats.max_ti_step << " | "
+      << stats.unparsed << " unparsed";
+  return out.str();
+}
+
+// "1234 messages | 12.3 MB/s, 375 msg/s | read wait 2650.2/41032.7 us | handling 3.1/120.4 us",
+// with read wait and handling as mean/max.
+auto format_stream_stats(const StreamStats& stream) -> std::string {
+  auto microseconds = [](std::chrono::nanoseconds value) {
+    return std::chrono::duration<double, std::micro>(value).count();
+  };
+  std::ostringstream out;
+  out << std::fixed << std::setprecision(1) << stream.messages << " messages | "
+      << stream.BytesPerSecond() / 1e6 << " MB/s, " << std::setprecision(0)
+      << stream.MessagesPerSecond() << " msg/s | read wait " << std::setprecision(1)
+      << microseconds(stream.read_wait_mean)
+      << "/" << microseconds(stream.read_wait_max) << " us | handling "
+      << microseconds(stream.handling_mean) << "/" << microseconds(stream.handling_max) << " us";
+  return out.str();
+}
+
+// "zstd 812.4 -> 97.3 MB, ratio 8.35, 412.0 MB/s"
+auto format_compression_stats(const CompressionStats& stats) -> std::string {
+  std::ostringstream out;
+  out << std::fixed << std::setprecision(1) << "zstd " << static_cast<double>(stats.raw_bytes) / 1e6
+      << " -> " << static_cast<double>(stats.compressed_bytes) / 1e6 << " MB, ratio "
+      << std::setprecision(2) << stats.Ratio() << ", " << std::setprecision(1)
+      << stats.BytesPerSecond() / 1e6 << " MB/s";
+  return out.str();
+}
+
+// "Conversions (raw2root): 3 done, 1 running, 2 queued, 0 failed"
+auto format_conversion_stats(const ConversionStats& stats) -> std::string {
+  return "Conversions (raw2root): " + std::to_string(stats.done) + " done, " +
+         std::to_string(stats.running) + " running, " + std::to_string(stats.queued) +
+         " queued, " + std::to_string(stats.failed) + " failed";
+}
+
+// Per detector: decoded frames, events and rate, then hits per ASIC and the
+// channels that are not ok as asic:channel, at most kListed per status.
+void print_quick_look(const QuickLook& quick_look) {
+  constexpr size_t kListed = 8;
+  std::cout << "  Quick look (1 in " << quick_look.SampleEvery() << " frames decoded, "
+            << quick_look.Dropped() << " dropped):\n";
+  for (const auto& detector : quick_look.Summary()) {
+    std::cout << "    " << shell::to_hex_string(detector.address) << ": " << detector.frames
+              << " frames | " << detector.events << " events, " << std::fixed
+              << std::setprecision(1) << detector.event_rate << " ev/s | pseudo "
+              << detector.pseudo_events << " | invalid " << detector.invalid_events
+              << " | corrupt frames " << detector.decode_errors << "\n";
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout << "      hits per ASIC";
+    for (const auto hits : detector.asic_hits) {
+      std::cout << " " << hits;
+    }
+    std::map<ChannelStatus, std::vector<size_t>> bad;
+    for (const auto& [index, status] : detector.bad_channels) {
+      bad[status].push_back(index);
+    }
+    for (const auto& [status, channels] : bad) {
+      std::cout << " | " << channel_status_name(status) << " " << channels.size() << " (";
+      for (size_t i = 0; i < std::min(channels.size(), kListed); ++i) {
+        std::cout << (i > 0 ? " " : "") << channels[i] / kChannelNum << ":"
+                  << channels[i] % kChannelNum;
+      }
+      std::cout << (channels.size() > kListed ? " ...)" : ")");
+    }
+    std::cout << "\n";
+  }
+}
+
+// Per logical address: the latest value of each status field of
+// hk_frame::kFields, followed by its range over the recent frames when it
+// changed.
+void print_hk_monitor(const HkMonitor& hk_monitor) {
+  const auto summaries = hk_monitor.Summaries();
+  if (summaries.empty()) {
+    return;
+  }
+  const auto now = std::chrono::steady_clock::now();
+  std::cout << "  HK (latest, [range over the last " << HkMonitor::kHistory << " frames]):\n";
+  for (const auto& summary : summaries) {
+    std::cout << "    " << shell::to_hex_string(summary.address) << ": " << summary.frames
+              << " frames, " << std::fixed << std::setprecision(1)
+              << std::chrono::duration<double>(now - summary.received).count() << " s ago";
+    std::cout.unsetf(std::ios::floatfield);
+    for (size_t i = 0; i < hk_frame::kFields.size(); ++i) {
+      const auto& field = hk_frame::kFields[i];
+      if (!field.status) {
+        continue;
+      }
+      std::cout << " | " << field.name << " ";
+      hk_frame::write_value(std::cout, field, summary.latest[i]);
+      if (summary.min[i] != summary.max[i]) {
+        std::cout << " [";
+        hk_frame::write_value(std::cout, field, summary.min[i]);
+        std::cout << "..";
+        hk_frame::write_value(std::cout, field, summary.max[i]);
+        std::cout << "]";
+      }
+    }
+    std::cout << "\n";
+  }
 }
 
 auto format_elapsed_time(std::chrono::steady_clock::duration elapsed) -> std::string {
@@ -321,19 +575,6 @@ auto parse_link_speed_token(std::string token) -> std::optional<superhero::SpwLi
   return std::nullopt;
 }
 
-auto shell_quote(const std::string& value) -> std::string {
-  std::string quoted = "'";
-  for (const char character : value) {
-    if (character == '\'') {
-      quoted += "'\\''";
-    } else {
-      quoted += character;
-    }
-  }
-  quoted += "'";
-  return quoted;
-}
-
 auto executable_directory() -> std::optional<std::filesystem::path> {
   std::error_code error;
 #if defined(__APPLE__)
@@ -486,11 +727,31 @@ auto do_sleep(const std::vector<std::string>& tokens) -> bool {
   return true;
 }
 
+// Endpoint names end up in output file names, so they are kept to a safe set.
+auto valid_endpoint_name(const std::string& name) -> bool {
+  return !name.empty() && name.size() <= 32 &&
+         std::all_of(name.begin(), name.end(), [](unsigned char c) {
+           return std::isalnum(c) != 0 || c == '-' || c == '_';
+         });
+}
+
 auto do_connect(const std::vector<std::string>& tokens) -> bool {
-  if (tokens.size() != 2) {
+  if (tokens.size() != 2 && tokens.size() != 3) {
     do_help({"help", "connect"});
     return false;
   }
+  const std::string name = tokens.size() == 3 ? tokens[2] : "default";
+  if (!valid_endpoint_name(name)) {
+    std::cout << "Invalid endpoint name " << name
+              << ": use up to 32 letters, digits, '-' and '_'.\n";
+    return false;
+  }
+  if (g_endpoints.count(name) != 0) {
+    std::cout << "Endpoint " << name << " is already connected to " << g_endpoints[name].target
+              << (tokens.size() == 2 ? "; name the new one: connect <host:port> <name>.\n"
+                                     : "; use 'endpoint remove " + name + "' first.\n");
+    return false;
+  }
   std::cout << "Connecting to " << tokens[1] << "...\n";
   // Keep the new channel local until its Echo succeeds so an interrupted
   // connection never leaves the shell in a partially connected state.
@@ -532,11 +793,62 @@ auto do_connect(const std::vector<std::string>& tokens) -> bool {
     return false;
   }
 
-  g_channel = std::move(channel);
-  g_stub = std::move(stub);
-  g_current_endpoint = tokens[1];
-  refresh_state_after_device_change();
-  std::cout << "Connected to " << tokens[1] << "\n";
+  g_endpoints[name] = {tokens[1], std::move(channel), std::move(stub)};
+  use_endpoint(name);
+  std::cout << "Connected to " << tokens[1];
+  if (g_endpoints.size() > 1) {
+    std::cout << " as endpoint " << name << " (" << g_endpoints.size() << " endpoints)";
+  }
+  std::cout << "\n";
+  return true;
+}
+
+auto do_endpoint(const std::vector<std::string>& tokens) -> bool {
+  if (tokens.size() > 3 || (tokens.size() == 3 && tokens[1] != "remove")) {
+    do_help({"help", "endpoint"});
+    return false;
+  }
+  if (tokens.size() == 1) {
+    if (g_endpoints.empty()) {
+      std::cout << "No endpoints connected. Use 'connect <host:port> [name]'.\n";
+      return true;
+    }
+    for (const auto& [name, endpoint] : g_endpoints) {
+      std::cout << (name == g_current_endpoint_name ? "* " : "  ") << std::left
+                << std::setw(12) << name << std::right << " " << endpoint.target << " | ";
+      const auto detectors = get_detector_logical_addresses(*endpoint.stub);
+      if (!detectors.has_value()) {
+        std::cout << "unreachable\n";
+        continue;
+      }
+      std::cout << detectors->size() << " detector(s)";
+      for (const auto address : *detectors) {
+        std::cout << " " << shell::to_hex_string(address);
+      }
+      std::cout << "\n";
+    }
+    return true;
+  }
+
+  const std::string& name = tokens.back();
+  if (g_endpoints.count(name) == 0) {
+    std::cout << "No endpoint named " << name << ".\n";
+    return false;
+  }
+  if (tokens.size() == 2) {
+    use_endpoint(name);
+    std::cout << "Current endpoint: " << name << " (" << g_current_endpoint << ")\n";
+    return true;
+  }
+  if (g_readout_active.load(std::memory_order_relaxed)) {
+    std::cout << "Endpoints cannot be removed during acquisition.\n";
+    return false;
+  }
+  g_endpoints.erase(name);
+  if (name == g_current_endpoint_name) {
+    use_endpoint(g_endpoints.empty() ? std::string() : g_endpoints.begin()->first);
+  }
+  std::cout << "Removed endpoint " << name << ".\n";
   return true;
 }
 
@@ -1296,6 +1608,43 @@ auto do_set_vareg(const std::vector<std::string>& tokens) -> bool {
   }
   // Record provenance only after the server accepted the upload.
   g_last_set_vareg_path = tokens[2];
+  g_set_vareg_paths[logical_address] = tokens[2];
+  return true;
+}
+
+auto do_disable_channels(const std::vector<std::string>& tokens) -> bool {
+  if (tokens.size() != 4 && tokens.size() != 5) {
+    do_help({"help", "disable_channels"});
+    return false;
+  }
+  std::set<std::string> statuses = {"dead", "stuck", "noisy", "hot"};
+  if (tokens.size() == 5) {
+    if (tokens[4].rfind("status=", 0) != 0) {
+      do_help({"help", "disable_channels"});
+      return false;
+    }
+    statuses.clear();
+    std::stringstream list(tokens[4].substr(7));
+    std::string status;
+    while (std::getline(list, status, ',')) {
+      if (!status.empty()) {
+        statuses.insert(status);
+      }
+    }
+  }
+  try {
+    auto vareg = shell::vareg::Vareg4ASIC::Load(tokens[1]);
+    std::ifstream channel_map(tokens[2]);
+    if (!channel_map) {
+      throw std::runtime_error("Could not open channel map " + tokens[2]);
+    }
+    const size_t disabled = shell::vareg::apply_channel_map(vareg, channel_map, statuses);
+    vareg.Save(tokens[3]);
+    std::cout << disabled << " channels disabled, VAREG written to " << tokens[3] << "\n";
+  } catch (const std::exception& e) {
+    std::cout << "Error: " << e.what() << "\n";
+    return false;
+  }
   return true;
 }
 
@@ -1394,14 +1743,140 @@ auto do_show(const std::vector<std::string>& tokens) -> bool {
   return true;
 }
 
+constexpr size_t kDataFrameBytes = 32768;
+constexpr size_t kHkFrameBytes = 1024;
+
+// One server streamed by a readout, with the detectors registered on it.
+struct ReadoutEndpoint {
+  std::string name;
+  std::string target;
+  std::shared_ptr<superhero::CommunicationService::Stub> stub;
+  std::vector<uint8_t> detector_addresses;
+};
+
 struct ReadoutSetup {
   std::chrono::nanoseconds duration;
   std::chrono::system_clock::time_point acquisition_time;
+  // Every connected endpoint with detectors; detector_addresses joins theirs.
+  std::vector<ReadoutEndpoint> endpoints;
   std::vector<uint8_t> detector_addresses;
+  WriterPolicy writer;
+  size_t ring_frames = RingFileWriter::kDefaultSlots;
+  CompressionPolicy compression;
+  RotationPolicy rotation;
+  // Background raw2root conversion of each completed data file or chunk.
+  size_t convert_jobs = 0;
+  std::vector<std::string> convert_args;
+  std::string converter;
+  // Decode one in quicklook_every data frames into quick-look histograms.
+  uint32_t quicklook_every = 0;
+  // Declared data rate per detector in bytes/s for preallocate=RATE; zero
+  // reserves space from the measured rate only.
+  uint64_t declared_rate = 0;
 };
 
+// Optional key=value tokens after <duration> <output_file_prefix>. A duration
+// or size of "off" (or 0) disables that trigger.
+auto parse_readout_options(const std::vector<std::string>& tokens, size_t first,
+                           ReadoutSetup& setup) -> bool {
+  WriterPolicy& policy = setup.writer;
+  for (size_t i = first; i < tokens.size(); ++i) {
+    const auto& token = tokens[i];
+    const auto eq_pos = token.find('=');
+    if (eq_pos == std::string::npos) {
+      emit_readout_message("Invalid readout option, expected key=value: " + token, true);
+      return false;
+    }
+    const std::string key = token.substr(0, eq_pos);
+    const std::string value = token.substr(eq_pos + 1);
+    const bool off = value == "off";
+    try {
+      if (key == "buffer") {
+        policy.buffer_bytes = static_cast<size_t>(shell::parse_size(value));
+        if (policy.buffer_bytes < BufferedFileWriter::kAlignment ||
+            policy.buffer_bytes > (size_t{1} << 30)) {
+          throw std::out_of_range("buffer must be between 4K and 1G");
+        }
+      } else if (key == "flush") {
+        policy.flush_interval = off ? 0ns : shell::parse_duration(value);
+      } else if (key == "sync") {
+        policy.sync_interval = off ? 0ns : shell::parse_duration(value);
+      } else if (key == "sync_bytes") {
+        policy.sync_bytes = off ? 0 : shell::parse_size(value);
+      } else if (key == "compress") {
+        if (!off && !kHaveZstd) {
+          emit_readout_message("compress= needs a hero_shell built with zstd", true);
+          return false;
+        }
+        setup.compression.enabled = !off;
+        if (!off) {
+          setup.compression.level = std::stoi(value);
+          if (setup.compression.level < -7 || setup.compression.level > 22) {
+            throw std::out_of_range("compression level must be between -7 and 22");
+          }
+        }
+      } else if (key == "compress_frames") {
+        const auto frames = shell::parse_uint32(value);
+        if (frames < 1 || frames > 1024) {
+          throw std::out_of_range("compress_frames must be between 1 and 1024");
+        }
+        setup.compression.chunk_bytes = frames * kDataFrameBytes;
+      } else if (key == "compress_threads") {
+        const auto threads = shell::parse_uint32(value);
+        if (threads > 64) {
+          throw std::out_of_range("compress_threads must be at most 64");
+        }
+        setup.compression.threads = static_cast<int>(threads);
+      } else if (key == "chunk_frames") {
+        setup.rotation.frames = off ? 0 : shell::parse_uint32(value);
+      } else if (key == "chunk_bytes") {
+        setup.rotation.bytes = off ? 0 : shell::parse_size(value);
+      } else if (key == "chunk_time") {
+        setup.rotation.interval = off ? 0ns : shell::parse_duration(value);
+      } else if (key == "convert") {
+        setup.convert_jobs = off ? 0 : shell::parse_uint32(value);
+        if (setup.convert_jobs > 64) {
+          throw std::out_of_range("convert must be at most 64 jobs");
+        }
+      } else if (key == "convert_args") {
+        setup.convert_args = shell::split_shell_like(value);
+      } else if (key == "preallocate") {
+        if (!off && !kHavePreallocate) {
+          emit_readout_message("preallocate= is not supported on this platform", true);
+          return false;
+        }
+        policy.preallocate = !off;
+        setup.declared_rate = off || value == "on" ? 0 : shell::parse_size(value);
+      } else if (key == "direct") {
+        if (value != "on" && !off) {
+          throw std::invalid_argument("expected on or off");
+        }
+        if (!off && !kHaveDirectIo) {
+          emit_readout_message("direct= is not supported on this platform", true);
+          return false;
+        }
+        policy.direct_io = !off;
+      } else if (key == "quicklook") {
+        setup.quicklook_every = off ? 0 : value == "all" ? 1 : shell::parse_uint32(value);
+      } else if (key == "ring") {
+        setup.ring_frames = static_cast<size_t>(shell::parse_uint32(value));
+        if (setup.ring_frames < 2 || setup.ring_frames > 65536) {
+          throw std::out_of_range("ring must be between 2 and 65536 frames");
+        }
+      } else {
+        emit_readout_message("Unknown readout option: " + key, true);
+        return false;
+      }
+    } catch (const std::exception& e) {
+      emit_readout_message("Error parsing readout option " + token + ": " + e.what(), true);
+      return false;
+    }
+  }
+  return true;
+}
+
 auto prepare_readout(const std::vector<std::string>& tokens) -> std::optional<ReadoutSetup> {
-  if (tokens.size() != 3) {
+  if (tokens.size() < 3) {
     do_help({"help", "readout"});
     return std::nullopt;
   }
@@ -1413,21 +1888,82 @@ auto prepare_readout(const std::vector<std::string>& tokens) -> std::optional<Re
     emit_readout_message("Error parsing duration: " + std::string(e.what()), true);
     return std::nullopt;
   }
+  ReadoutSetup setup;
+  setup.duration = duration;
+  if (!parse_readout_options(tokens, 3, setup)) {
+    return std::nullopt;
+  }
+  if (setup.convert_jobs > 0) {
+    if (setup.compression.enabled) {
+      emit_readout_message("convert= needs raw data files; it cannot be used with compress=",
+                           true);
+      return std::nullopt;
+    }
+    const auto converter = find_auxiliary_file("raw2root", true);
+    if (!converter.has_value()) {
+      emit_readout_message("convert= needs raw2root next to hero_shell or on PATH", true);
+      return std::nullopt;
+    }
+    setup.converter = *converter;
+  }
 
   if (!ensure_grpc_initialized()) {
     return std::nullopt;
   }
 
-  auto detector_addresses = get_detector_logical_addresses();
-  if (!detector_addresses.has_value()) {
-    return std::nullopt;
+  // Outputs and frame counters are keyed by logical address, so an address
+  // may be registered on one endpoint only.
+  std::map<uint8_t, std::string> owners;
+  for (const auto& [name, endpoint] : g_endpoints) {
+    auto detector_addresses = get_detector_logical_addresses(*endpoint.stub);
+    if (!detector_addresses.has_value()) {
+      emit_readout_message("Cannot list the detectors of endpoint " + name, true);
+      return std::nullopt;
+    }
+    if (detector_addresses->empty()) {
+      continue;
+    }
+    for (const auto address : *detector_addresses) {
+      const auto [owner, inserted] = owners.emplace(address, name);
+      if (!inserted) {
+        emit_readout_message("Detector " + shell::to_hex_string(address) +
+                                 " is registered on both endpoints " + owner->second + " and " +
+                                 name,
+                             true);
+        return std::nullopt;
+      }
+      setup.detector_addresses.push_back(address);
+    }
+    setup.endpoints.push_back({name, endpoint.target, endpoint.stub, *detector_addresses});
   }
-  if (detector_addresses->empty()) {
+  if (setup.endpoints.empty()) {
     emit_readout_message("No detectors registered for readout.", true);
     return std::nullopt;
   }
 
-  return ReadoutSetup{duration, std::chrono::system_clock::now(), *detector_addresses};
+  setup.acquisition_time = std::chrono::system_clock::now();
+  return setup;
+}
+
+// Size of one data file, or one chunk of a rotated output, at the declared
+// rate: what preallocate=RATE reserves when the file opens. Compressed sizes
+// are not predictable, so those files grow by measured extents only.
+auto readout_expected_bytes(const ReadoutSetup& setup) -> uint64_t {
+  if (setup.declared_rate == 0 || setup.compression.enabled) {
+    return 0;
+  }
+  auto seconds = std::chrono::duration<double>(setup.duration).count();
+  if (setup.rotation.interval.count() > 0) {
+    seconds = std::min(seconds, std::chrono::duration<double>(setup.rotation.interval).count());
+  }
+  auto bytes = static_cast<uint64_t>(static_cast<double>(setup.declared_rate) * seconds);
+  if (setup.rotation.bytes > 0) {
+    bytes = std::min(bytes, setup.rotation.bytes);
+  }
+  if (setup.rotation.frames > 0) {
+    bytes = std::min(bytes, setup.rotation.frames * kDataFrameBytes);
+  }
+  return bytes;
 }
 
 auto readout_file_prefix(const std::string& output_prefix, const ReadoutSetup& setup)
@@ -1435,32 +1971,227 @@ auto readout_file_prefix(const std::string& output_prefix, const ReadoutSetup& s
   return output_prefix + "_" + format_yyMMdd_hhmmss(setup.acquisition_time);
 }
 
+// <base><extension>, or <base>_NNNNNN<extension> for chunk NNNNNN of a
+// rotated output. A nullopt chunk gives the literal pattern, for display.
+auto readout_output_filename(const std::string& base, const std::string& extension,
+                             const ReadoutSetup& setup, std::optional<uint32_t> chunk)
+    -> std::string {
+  if (!setup.rotation.Enabled()) {
+    return base + extension;
+  }
+  std::ostringstream name;
+  name << base << "_";
+  if (chunk.has_value()) {
+    name << std::setw(6) << std::setfill('0') << *chunk;
+  } else {
+    name << "NNNNNN";
+  }
+  name << extension;
+  return name.str();
+}
+
+// <prefix>_0xNN, with a .zst suffix when the data files are compressed.
+auto readout_data_filename(const std::string& file_prefix, uint8_t address,
+                           const ReadoutSetup& setup,
+                           std::optional<uint32_t> chunk = std::nullopt) -> std::string {
+  return readout_output_filename(file_prefix + "_" + shell::to_hex_string(address),
+                                 setup.compression.enabled ? ".zst" : "", setup, chunk);
+}
+
+// HK is written per detector like the data, output "HK/0xNN" and
+// <prefix>_hk_0xNN, since an HK frame does not name its detector: each file
+// holds the series of one logical address.
+auto readout_hk_output(uint8_t address) -> std::string {
+  return "HK/" + shell::to_hex_string(address);
+}
+
+auto readout_hk_filename(const std::string& file_prefix, uint8_t address,
+                         const ReadoutSetup& setup, std::optional<uint32_t> chunk = std::nullopt)
+    -> std::string {
+  return readout_output_filename(file_prefix + "_hk_" + shell::to_hex_string(address), "", setup,
+                                 chunk);
+}
+
+auto readout_hk_filenames(const std::string& file_prefix, const ReadoutSetup& setup)
+    -> std::map<std::string, std::string> {
+  std::map<std::string, std::string> filenames;
+  for (const auto address : setup.detector_addresses) {
+    filenames[readout_hk_output(address)] = readout_hk_filename(file_prefix, address, setup);
+  }
+  return filenames;
+}
+
+// Directory of log.txt and the chunk manifest: that of the output prefix.
+auto readout_log_directory(const std::string& output_prefix) -> std::filesystem::path {
+  return std::filesystem::path(output_prefix).parent_path();
+}
+
+// Run manifest of a rotated readout, listing every completed chunk. One line
+// per chunk, appended once the chunk is closed and synced, so every file it
+// lists is complete and no longer written:
+//   <path> <output> <chunk> <frames> <raw bytes> <file bytes> <opened> <closed>
+// Paths are relative to the manifest's directory, as in log.txt.
+class ChunkManifest {
+ public:
+  auto Open(const std::string& path) -> bool {
+    base_ = std::filesystem::path(path).parent_path();
+    out_.open(path, std::ios::app);
+    if (out_.is_open() && out_.tellp() == std::streampos(0)) {
+      out_ << "# path output chunk frames raw_bytes file_bytes opened closed\n" << std::flush;
+    }
+    return out_.is_open();
+  }
+
+  // Called from the writer threads.
+  void Record(const std::string& output, const ChunkInfo& chunk) {
+    std::filesystem::path relative_path = chunk.path;
+    try {
+      relative_path =
+          std::filesystem::relative(chunk.path, base_.empty() ? std::filesystem::path(".") : base_);
+    } catch (const std::exception&) {
+      relative_path = chunk.path;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    out_ << relative_path.string() << " " << output << " " << chunk.index << " " << chunk.frames
+         << " " << chunk.raw_bytes << " " << chunk.file_bytes << " "
+         << format_iso8601(chunk.opened) << " " << format_iso8601(chunk.closed) << "\n"
+         << std::flush;
+    if (!out_ && !failed_) {
+      failed_ = true;
+      emit_readout_message("Failed to write the chunk manifest", true);
+    }
+  }
+
+ private:
+  std::mutex mutex_;
+  std::ofstream out_;
+  std::filesystem::path base_;
+  bool failed_ = false;
+};
+
+auto readout_manifest_filename(const std::string& file_prefix) -> std::string {
+  return file_prefix + "_manifest.txt";
+}
+
 void print_readout_outputs(const std::string& file_prefix, const ReadoutSetup& setup,
                            const std::optional<std::string>& register_output = std::nullopt) {
   for (const auto address : setup.detector_addresses) {
-    std::cout << "  Data " << shell::to_hex_string(address) << ": " << file_prefix << "_"
-              << shell::to_hex_string(address) << "\n";
+    std::cout << "  Data " << shell::to_hex_string(address) << ": "
+              << readout_data_filename(file_prefix, address, setup) << "\n";
+  }
+  for (const auto& [output, filename] : readout_hk_filenames(file_prefix, setup)) {
+    std::cout << "  " << output << ": " << filename << "\n";
+  }
+  if (setup.rotation.Enabled()) {
+    std::cout << "  Manifest: " << readout_manifest_filename(file_prefix) << "\n";
   }
-  std::cout << "  HK: " << file_prefix << "_hk\n";
   if (register_output.has_value()) {
     std::cout << "  Register: " << *register_output << "\n";
   }
 }
 
+// " of <name>" for messages about one endpoint of a multi-endpoint readout.
+auto readout_endpoint_suffix(const ReadoutSetup& setup, size_t endpoint) -> std::string {
+  return setup.endpoints.size() > 1 ? " of " + setup.endpoints[endpoint].name : "";
+}
+
+// Runs rpc on every endpoint's stub concurrently, so the servers of a
+// multi-endpoint readout start and stop within one round trip of each other
+// rather than one after another. Returns each endpoint's error, empty on success.
+template <typename Rpc>
+auto call_readout_endpoints(const ReadoutSetup& setup, const Rpc& rpc)
+    -> std::vector<std::string> {
+  std::vector<std::string> errors(setup.endpoints.size());
+  std::vector<std::thread> calls;
+  for (size_t i = 0; i < setup.endpoints.size(); ++i) {
+    calls.emplace_back([&, i]() { errors[i] = rpc(*setup.endpoints[i].stub); });
+  }
+  for (auto& call : calls) {
+    call.join();
+  }
+  return errors;
+}
+
+auto start_data_stream(superhero::CommunicationService::Stub& stub) -> std::string {
+  ::superhero::StartDataStreamRequest req;
+  ::superhero::StartDataStreamReply rep;
+  ::grpc::ClientContext context;
+  // A background readout must not make `readout stop` or shell exit wait
+  // forever if the server becomes unresponsive before the stream starts.
+  context.set_deadline(std::chrono::system_clock::now() + std::chrono::seconds(10));
+  const auto status = stub.StartDataStream(&context, req, &rep);
+  if (!status.ok()) {
+    return "StartDataStream RPC failed: " + status.error_message();
+  }
+  if (!rep.accepted()) {
+    return "Failed to start data stream: " + rep.message();
+  }
+  return {};
+}
+
+auto stop_data_stream(superhero::CommunicationService::Stub& stub) -> std::string {
+  ::superhero::StopDataStreamRequest stop_req;
+  ::superhero::StopDataStreamReply stop_rep;
+  ::grpc::ClientContext stop_context;
+  // Headroom over the server's own internal 5s stop timeout, so we receive
+  // its timeout message instead of a bare DEADLINE_EXCEEDED.
+  stop_context.set_deadline(std::chrono::system_clock::now() + std::chrono::seconds(7));
+  const auto stop_status = stub.StopDataStream(&stop_context, stop_req, &stop_rep);
+  if (!stop_status.ok()) {
+    return stop_status.error_message();
+  }
+  if (!stop_rep.accepted()) {
+    return stop_rep.message();
+  }
+  return {};
+}
+
+// frame_tap, when given, receives a copy of every frame written to disk.
 auto do_readout_foreground(const std::vector<std::string>& tokens,
-                           const std::optional<ReadoutSetup>& prepared_setup = std::nullopt)
-    -> bool {
+                           const std::optional<ReadoutSetup>& prepared_setup = std::nullopt,
+                           FrameTap* frame_tap = nullptr) -> bool {
   const auto setup = prepared_setup.has_value() ? prepared_setup : prepare_readout(tokens);
   if (!setup.has_value()) {
     return false;
   }
 
   std::string output_datafileprefix = tokens[2];
-  std::map<uint8_t, std::unique_ptr<std::ofstream>> output_datafiles;
-  std::unique_ptr<std::ofstream> output_hkfile;
+  // Declared before the writers, whose threads report into it until joined.
+  std::atomic<bool> readout_failed{false};
+  auto on_write_error = [&readout_failed](const std::string& error) {
+    emit_readout_message("Failed to write output file: " + error, true);
+    readout_failed.store(true, std::memory_order_relaxed);
+  };
+  // Written by the writer threads as chunks complete, so also declared first.
+  ChunkManifest manifest;
+  std::unique_ptr<ConversionPool> converter;
+  if (setup->convert_jobs > 0) {
+    converter = std::make_unique<ConversionPool>(
+        setup->converter, setup->convert_args, setup->convert_jobs,
+        [](const std::string& input, bool ok, const std::string& detail) {
+          if (!ok) {
+            emit_readout_message("Conversion of " + input + " failed: " + detail, true);
+          }
+        });
+  }
+  // Quick-look decoding gets its own tap, so it can drop frames without
+  // holding back the caller's tap (pedcalib) or the writers.
+  std::shared_ptr<QuickLook> quick_look;
+  std::unique_ptr<FrameTap> quick_look_tap;
+  if (setup->quicklook_every > 0) {
+    quick_look = std::make_shared<QuickLook>(setup->detector_addresses, setup->quicklook_every);
+    quick_look_tap =
+        std::make_unique<FrameTap>([quick_look](uint8_t address, std::string_view frame) {
+          quick_look->AddFrame(address, frame);
+        });
+    set_readout_quick_look(quick_look);
+  }
+  const auto hk_monitor = std::make_shared<HkMonitor>();
+  set_readout_hk_monitor(hk_monitor);
+  // One writer thread per output file, fed through its ring by the reader.
+  std::map<uint8_t, std::unique_ptr<RingFileWriter>> output_datafiles;
+  std::map<uint8_t, std::unique_ptr<RingFileWriter>> output_hkfiles;
 
-  std::mutex frame_counter_mutex;
-  std::map<uint8_t, size_t> frame_counters;
   const auto acquisition_time = setup->acquisition_time;
   const auto duration = setup->duration;
   const std::string file_prefix = readout_file_prefix(output_datafileprefix, *setup);
@@ -1469,38 +2200,118 @@ auto do_readout_foreground(const std::vector<std::string>& tokens,
   std::ostringstream exposure_seconds_stream;
   exposure_seconds_stream << std::chrono::duration<double>(duration).count();
   const auto exposure_seconds_value = exposure_seconds_stream.str();
-  auto build_xattr_map =
-      [&](std::optional<uint8_t> logical_address) -> std::map<std::string, std::string> {
+  auto build_xattr_map = [&](uint8_t logical_address) -> std::map<std::string, std::string> {
     std::map<std::string, std::string> attributes;
     attributes["acquired_date"] = acquired_date_value;
     attributes["exposure_sec"] = exposure_seconds_value;
-    attributes["logical_address"] =
-        logical_address.has_value() ? shell::to_hex_string(logical_address.value()) : "N/A";
+    attributes["logical_address"] = shell::to_hex_string(logical_address);
     return attributes;
   };
 
-  const std::string hk_filename = file_prefix + "_hk";
-  output_hkfile = std::make_unique<std::ofstream>(hk_filename, std::ios::binary);
-  if (!output_hkfile->is_open()) {
-    emit_readout_message("Failed to open output file: " + hk_filename, true);
-    return false;
+  const bool rotating = setup->rotation.Enabled();
+  if (rotating) {
+    const auto manifest_filename = readout_manifest_filename(file_prefix);
+    if (!manifest.Open(manifest_filename)) {
+      emit_readout_message("Failed to open chunk manifest: " + manifest_filename, true);
+      return false;
+    }
   }
-  apply_xattr_to_file(hk_filename, build_xattr_map(std::nullopt));
+  // Every chunk gets the attributes; completed chunks go to the manifest.
+  auto open_output = [&](RingFileWriter& writer, uint8_t logical_address, bool hk) {
+    const std::string output =
+        hk ? readout_hk_output(logical_address) : shell::to_hex_string(logical_address);
+    auto path_of = [file_prefix, &setup, logical_address, hk](uint32_t chunk) {
+      return hk ? readout_hk_filename(file_prefix, logical_address, *setup, chunk)
+                : readout_data_filename(file_prefix, logical_address, *setup, chunk);
+    };
+    // HK files are not converted; neither is an empty first chunk.
+    const bool convert = converter && !hk;
+    auto on_closed = [&manifest, &converter, output, rotating, convert](const ChunkInfo& chunk) {
+      if (rotating) {
+        manifest.Record(output, chunk);
+      }
+      if (convert && chunk.frames > 0) {
+        converter->Submit(chunk.path);
+      }
+    };
+    return writer.OpenChunks(
+        path_of, setup->rotation,
+        [attributes = build_xattr_map(logical_address)](const std::string& path) {
+          apply_xattr_to_file(path, attributes);
+        },
+        rotating || convert ? RingFileWriter::OnChunkClosed(on_closed) : nullptr);
+  };
 
+  std::map<uint8_t, size_t> endpoint_of;
+  for (size_t endpoint = 0; endpoint < setup->endpoints.size(); ++endpoint) {
+    for (const auto addr : setup->endpoints[endpoint].detector_addresses) {
+      endpoint_of[addr] = endpoint;
+    }
+  }
+  // HK frames are decoded into the monitor on their writer thread, after the
+  // file accepted them, so the receive thread only moves the Cord. A frame
+  // received in several pieces is first copied into scratch.
+  for (const auto addr : setup->detector_addresses) {
+    auto& hkfile = output_hkfiles[addr] =
+        std::make_unique<RingFileWriter>(setup->writer, setup->ring_frames);
+    if (!open_output(*hkfile, addr, true)) {
+      emit_readout_message("Failed to open output file: " + hkfile->Error(), true);
+      return false;
+    }
+    hkfile->Start(
+        [addr, hk_monitor, scratch = std::string{}](const absl::Cord& frame) mutable {
+          if (const auto flat = frame.TryFlat(); flat.has_value()) {
+            hk_monitor->Record(addr, flat->data());
+          } else {
+            absl::CopyCordToString(frame, &scratch);
+            hk_monitor->Record(addr, scratch.data());
+          }
+        },
+        on_write_error);
+  }
+
+  // HK files are small; they reserve from the measured rate only.
+  WriterPolicy data_policy = setup->writer;
+  data_policy.preallocate_bytes = readout_expected_bytes(*setup);
   for (const auto& addr : setup->detector_addresses) {
-    std::string datafilename = file_prefix + "_" + shell::to_hex_string(addr);
-    output_datafiles[addr] = std::make_unique<std::ofstream>(datafilename, std::ios::binary);
-    {
-      std::lock_guard<std::mutex> lock(frame_counter_mutex);
-      frame_counters[addr] = 0;
-    }
-    if (!output_datafiles[addr]->is_open()) {
-      emit_readout_message("Failed to open output file: " + datafilename, true);
+    output_datafiles[addr] =
+        std::make_unique<RingFileWriter>(data_policy, setup->ring_frames, setup->compression);
+    if (!open_output(*output_datafiles[addr], addr, false)) {
+      emit_readout_message("Failed to open output file: " + output_datafiles[addr]->Error(),
+                           true);
       return false;
     }
-    apply_xattr_to_file(datafilename, build_xattr_map(addr));
+    // Frames are counted, and offered to the tap, once the writer accepted
+    // them; buffered bytes reach the disk per the writer policy and at the
+    // latest when the files close.
+    // The lambda runs on this detector's writer thread only, so its sample
+    // counter and continuity state need no synchronization. Continuity reads
+    // two event headers per frame; a frame received in several pieces is
+    // first copied into scratch, a reused buffer.
+    output_datafiles[addr]->Start(
+        [addr, frame_tap, tap = quick_look_tap.get(), every = setup->quicklook_every,
+         sampled = uint32_t{0}, continuity = EventContinuity{},
+         scratch = std::string{}](const absl::Cord& frame) mutable {
+          increment_readout_frame_count(addr);
+          if (const auto flat = frame.TryFlat(); flat.has_value()) {
+            continuity.AddFrame(std::string_view(flat->data(), flat->size()));
+          } else {
+            absl::CopyCordToString(frame, &scratch);
+            continuity.AddFrame(scratch);
+          }
+          g_readout_continuity[addr].Store(continuity.GetStats());
+          if (frame_tap != nullptr) {
+            frame_tap->Push(addr, frame);
+          }
+          if (tap != nullptr && ++sampled >= every) {
+            sampled = 0;
+            tap->Push(addr, frame);
+          }
+        },
+        on_write_error);
   }
-  set_readout_outputs(file_prefix, hk_filename, setup->detector_addresses);
+  set_readout_outputs(file_prefix, readout_hk_filenames(file_prefix, *setup),
+                      setup->detector_addresses);
   if (!g_interactive_shell) {
     emit_readout_message("Output data files created with prefix: " + file_prefix);
   }
@@ -1508,8 +2319,7 @@ auto do_readout_foreground(const std::vector<std::string>& tokens,
   {
     std::vector<uint8_t> sorted_addresses = setup->detector_addresses;
     std::sort(sorted_addresses.begin(), sorted_addresses.end());
-    std::filesystem::path prefix_path(output_datafileprefix);
-    auto parent_dir = prefix_path.parent_path();
+    auto parent_dir = readout_log_directory(output_datafileprefix);
     std::string log_filename = parent_dir.empty() ? "log.txt" : (parent_dir / "log.txt").string();
     std::ofstream readout_log(log_filename, std::ios::app);
     if (!readout_log.is_open()) {
@@ -1518,11 +2328,12 @@ auto do_readout_foreground(const std::vector<std::string>& tokens,
     }
     const std::filesystem::path log_base = parent_dir;
     for (const auto& addr : sorted_addresses) {
-      const auto datafilename = file_prefix + "_" + shell::to_hex_string(addr);
+      // The first chunk stands for a rotated output; the manifest lists the rest.
+      const auto datafilename = readout_data_filename(file_prefix, addr, *setup, 0);
       bool force_flag = false;
       try {
-        auto data = superhero::grpc::rmapRead(
-            *g_stub, addr, ::superhero::CdTeDSDAddress_ForcetrigFlag, 4);
+        auto data = superhero::grpc::rmapRead(*setup->endpoints[endpoint_of.at(addr)].stub,
+                                              addr, ::superhero::CdTeDSDAddress_ForcetrigFlag, 4);
         if (data.size() != 4) {
           emit_readout_message("Unexpected ForcetrigFlag size for " +
                                    shell::to_hex_string(addr) + ": " +
@@ -1553,145 +2364,217 @@ auto do_readout_foreground(const std::vector<std::string>& tokens,
     }
   }
 
-  try {
-    ::superhero::StartDataStreamRequest req;
-    ::superhero::StartDataStreamReply rep;
-    ::grpc::ClientContext context;
-    // A background readout must not make `readout stop` or shell exit wait
-    // forever if the server becomes unresponsive before the stream starts.
-    context.set_deadline(std::chrono::system_clock::now() + std::chrono::seconds(10));
-    const auto status = g_stub->StartDataStream(&context, req, &rep);
-    if (!status.ok()) {
-      throw std::runtime_error("StartDataStream RPC failed: " + status.error_message());
+  {
+    const auto errors = call_readout_endpoints(*setup, start_data_stream);
+    bool started = true;
+    for (size_t i = 0; i < errors.size(); ++i) {
+      if (!errors[i].empty()) {
+        emit_readout_message("Failed to start data stream" + readout_endpoint_suffix(*setup, i) +
+                                 ": " + errors[i],
+                             true);
+        started = false;
+      }
     }
-    if (!rep.accepted()) {
-      throw std::runtime_error("Failed to start data stream: " + rep.message());
+    if (!started) {
+      // Leave no server of a multi-endpoint readout streaming on its own.
+      for (size_t i = 0; i < errors.size(); ++i) {
+        if (errors[i].empty()) {
+          const auto stop_error = stop_data_stream(*setup->endpoints[i].stub);
+          if (!stop_error.empty()) {
+            emit_readout_message("Failed to stop data stream" +
+                                     readout_endpoint_suffix(*setup, i) + ": " + stop_error,
+                                 true);
+          }
+        }
+      }
+      return false;
     }
     std::this_thread::sleep_for(100ms);
-  } catch (const std::exception& e) {
-    emit_readout_message("Failed to start data stream: " + std::string(e.what()), true);
-    return false;
   }
 
-  // Stream context lives outside the reader thread so the main thread can
-  // TryCancel() a blocked Read() if the server does not close the stream.
-  ::grpc::ClientContext stream_context;
-  std::atomic<bool> reader_done{false};
-  std::atomic<bool> readout_failed{false};
-
-  auto readout_thread = std::thread([stub = g_stub.get(), &output_datafiles, &frame_counters,
-                                     &frame_counter_mutex, &output_hkfile, &stream_context,
-                                     &reader_done, &readout_failed]() -> void {
-    ::superhero::DataStreamRequest req;
-    ::superhero::DataStreamReply rep;
-
-    auto reader = std::unique_ptr<::grpc::ClientReader<::superhero::DataStreamReply>>(
-        stub->DataStream(&stream_context, req));
-    while (reader->Read(&rep)) {
-      const auto logical_address_raw = static_cast<uint32_t>(rep.logical_address());
-      if (logical_address_raw > std::numeric_limits<uint8_t>::max()) {
-        emit_readout_message("Received DataStream frame with unsupported logical address " +
-                                 shell::to_hex_string(logical_address_raw) + ", dropping frame",
-                             true);
-        continue;
-      }
-      const auto logical_address = static_cast<uint8_t>(logical_address_raw);
-
-      switch (rep.type()) {
-        case superhero::DataStreamType::DataStreamType_FrameData: {
-          auto data = rep.value();
-          if (data.size() != 32768) {
-            emit_readout_message("Received DataStream frame with unexpected size: " +
-                                     std::to_string(data.size()) + ", expected: 32768",
-                                 true);
-            continue;
-          }
-          {
-            std::lock_guard<std::mutex> lock(frame_counter_mutex);
-            if (frame_counters.find(logical_address) == frame_counters.end()) {
-              emit_readout_message("Received data frame for unregistered logical address " +
-                                       shell::to_hex_string(logical_address) +
-                                       ", dropping frame data",
-                                   true);
-              continue;
-            }
-          }
-          auto datafile_it = output_datafiles.find(logical_address);
-          if (datafile_it == output_datafiles.end() || !datafile_it->second ||
-              !datafile_it->second->is_open()) {
-            emit_readout_message("Output file for logical address " +
-                                     shell::to_hex_string(logical_address) +
-                                     " is not available, dropping frame data",
-                                 true);
-            continue;
-          }
-          auto raw_data = data.Flatten();
-          *(datafile_it->second) << raw_data;
-          *(datafile_it->second) << std::flush;
-          if (!datafile_it->second->good()) {
-            emit_readout_message("Failed to write frame data for logical address " +
-                                     shell::to_hex_string(logical_address),
-                                 true);
-            readout_failed.store(true, std::memory_order_relaxed);
-            continue;
-          }
-          // Count only frames that were actually written to disk.
-          {
-            std::lock_guard<std::mutex> lock(frame_counter_mutex);
-            frame_counters[logical_address] += 1;
-          }
-          increment_readout_frame_count(logical_address);
-          break;
+  // One DataStream per endpoint, each read by its own thread. The context
+  // lives outside the reader thread so the main thread can TryCancel() a
+  // blocked Read() if the server does not close the stream.
+  struct EndpointStream {
+    ::grpc::ClientContext context;
+    std::atomic<bool> done{false};
+    StreamMeter meter;
+    std::thread reader;
+  };
+  std::vector<std::unique_ptr<EndpointStream>> streams;
+
+  // Validates a received message and moves its payload into a writer's ring.
+  // The payload is a Cord; it is handed over as is, never copied or
+  // flattened on the receive thread, so a slow disk never delays the next
+  // read until a ring fills up. Each ring has a single producer, so a data or
+  // HK frame is only accepted from the endpoint its detector is registered on.
+  auto hand_off = [&output_datafiles, &output_hkfiles, &endpoint_of](
+                      ::superhero::DataStreamReply& rep, size_t endpoint) {
+    const auto logical_address_raw = static_cast<uint32_t>(rep.logical_address());
+    if (logical_address_raw > std::numeric_limits<uint8_t>::max()) {
+      emit_readout_message("Received DataStream frame with unsupported logical address " +
+                               shell::to_hex_string(logical_address_raw) + ", dropping frame",
+                           true);
+      return;
+    }
+    const auto logical_address = static_cast<uint8_t>(logical_address_raw);
+
+    switch (rep.type()) {
+      case superhero::DataStreamType::DataStreamType_FrameData: {
+        const auto& data = rep.value();
+        if (data.size() != kDataFrameBytes) {
+          emit_readout_message("Received DataStream frame with unexpected size: " +
+                                   std::to_string(data.size()) + ", expected: 32768",
+                               true);
+          return;
         }
-        case superhero::DataStreamType::DataStreamType_HKData: {
-          auto data = rep.value();
-          if (data.size() != 1024) {
-            emit_readout_message("Received HK DataStream frame with unexpected size: " +
-                                     std::to_string(data.size()) + ", expected: 1024",
-                                 true);
-            continue;
-          }
-          (*output_hkfile) << data.Flatten() << std::flush;
-          if (!output_hkfile->good()) {
-            emit_readout_message("Failed to write HK data", true);
-            readout_failed.store(true, std::memory_order_relaxed);
-          }
-          break;
+        // The map is not modified while the reader runs, so no lock.
+        auto datafile_it = output_datafiles.find(logical_address);
+        if (datafile_it == output_datafiles.end() ||
+            endpoint_of.at(logical_address) != endpoint) {
+          emit_readout_message("Received data frame for unregistered logical address " +
+                                   shell::to_hex_string(logical_address) +
+                                   ", dropping frame data",
+                               true);
+          return;
+        }
+        datafile_it->second->Push(std::move(*rep.mutable_value()));
+        return;
+      }
+      case superhero::DataStreamType::DataStreamType_HKData: {
+        const auto& data = rep.value();
+        if (data.size() != kHkFrameBytes) {
+          emit_readout_message("Received HK DataStream frame with unexpected size: " +
+                                   std::to_string(data.size()) + ", expected: 1024",
+                               true);
+          return;
         }
-        default: {
-          emit_readout_message("Received DataStream frame with unknown type: " +
-                                   std::to_string(rep.type()),
+        auto hkfile_it = output_hkfiles.find(logical_address);
+        if (hkfile_it == output_hkfiles.end() || endpoint_of.at(logical_address) != endpoint) {
+          emit_readout_message("Received HK frame for unregistered logical address " +
+                                   shell::to_hex_string(logical_address) + ", dropping HK data",
                                true);
-          continue;
+          return;
         }
+        hkfile_it->second->Push(std::move(*rep.mutable_value()));
+        return;
       }
-      if (g_readout_stop_requested.load(std::memory_order_relaxed) ||
-          g_interrupted.load(std::memory_order_relaxed)) {
-        break;
+      default: {
+        emit_readout_message("Received DataStream frame with unknown type: " +
+                                 std::to_string(rep.type()),
+                             true);
+        return;
       }
     }
-    auto finish_status = reader->Finish();
+  };
+
+  // Each stream is read through a completion queue on its thread. Two reply
+  // buffers alternate: the next read is posted before the message that just
+  // arrived is handed off, so gRPC always has a read outstanding. gRPC allows
+  // one outstanding read per stream, so this is as far ahead as reads can go.
+  auto read_stream = [&setup, &readout_failed, &hand_off](size_t endpoint,
+                                                          EndpointStream& stream) -> void {
+    auto* stub = setup->endpoints[endpoint].stub.get();
+    enum Tag : intptr_t { kStartTag = 1, kReadTag, kFinishTag };
+    auto tag_of = [](Tag tag) { return reinterpret_cast<void*>(tag); };  // NOLINT
+
+    ::superhero::DataStreamRequest req;
+    std::array<::superhero::DataStreamReply, 2> replies;
+    ::grpc::CompletionQueue completion_queue;
+    auto reader = stub->PrepareAsyncDataStream(&stream.context, req, &completion_queue);
+    reader->StartCall(tag_of(kStartTag));
+
+    void* tag = nullptr;
+    bool ok = false;
+    bool reading = completion_queue.Next(&tag, &ok) && ok;
+    size_t current = 0;
+    auto posted = std::chrono::steady_clock::now();
+    if (reading) {
+      reader->Read(&replies[current], tag_of(kReadTag));
+    }
+    // A read completes with ok == false when the server ends the stream or the
+    // main thread cancels it with TryCancel.
+    while (reading && completion_queue.Next(&tag, &ok) && ok) {
+      const auto arrived = std::chrono::steady_clock::now();
+      const auto read_wait = arrived - posted;
+      auto& rep = replies[current];
+      const bool stop = g_readout_stop_requested.load(std::memory_order_relaxed) ||
+                        g_interrupted.load(std::memory_order_relaxed);
+      if (!stop) {
+        current ^= 1U;
+        posted = std::chrono::steady_clock::now();
+        reader->Read(&replies[current], tag_of(kReadTag));
+      }
+      const size_t bytes = rep.value().size();
+      hand_off(rep, endpoint);
+      stream.meter.Record(bytes, read_wait, std::chrono::steady_clock::now() - arrived);
+      reading = !stop;
+    }
+
+    ::grpc::Status finish_status;
+    reader->Finish(&finish_status, tag_of(kFinishTag));
+    while (completion_queue.Next(&tag, &ok) && tag != tag_of(kFinishTag)) {
+    }
+    completion_queue.Shutdown();
+    while (completion_queue.Next(&tag, &ok)) {
+    }
     if (!finish_status.ok() && finish_status.error_code() != ::grpc::StatusCode::CANCELLED) {
-      emit_readout_message("DataStream terminated with error: " + finish_status.error_message(),
+      emit_readout_message("DataStream" + readout_endpoint_suffix(*setup, endpoint) +
+                               " terminated with error: " + finish_status.error_message(),
                            true);
       readout_failed.store(true, std::memory_order_relaxed);
     }
-    reader_done.store(true, std::memory_order_relaxed);
-  });
+    stream.done.store(true, std::memory_order_relaxed);
+  };
+  for (size_t i = 0; i < setup->endpoints.size(); ++i) {
+    auto& stream = *streams.emplace_back(std::make_unique<EndpointStream>());
+    stream.reader = std::thread(read_stream, i, std::ref(stream));
+  }
+
+  auto frames_written = [&output_datafiles]() {
+    std::map<uint8_t, size_t> counters;
+    for (const auto& [addr, writer] : output_datafiles) {
+      counters[addr] = writer->FramesWritten();
+    }
+    return counters;
+  };
+  auto stream_stats = [&streams, &setup]() {
+    std::vector<std::pair<std::string, StreamStats>> stats;
+    for (size_t i = 0; i < streams.size(); ++i) {
+      stats.emplace_back(setup->endpoints.size() > 1 ? setup->endpoints[i].name : "",
+                         streams[i]->meter.Snapshot());
+    }
+    return stats;
+  };
+  auto publish_writer_stats = [&output_datafiles, &output_hkfiles, &stream_stats, &setup,
+                               &converter, &quick_look, &quick_look_tap]() {
+    std::map<std::string, ReadoutWriterStats> writers;
+    for (const auto& [addr, writer] : output_datafiles) {
+      writers[shell::to_hex_string(addr)] = {writer->Stats(), writer->Compression(),
+                                             writer->ChunksClosed()};
+    }
+    for (const auto& [addr, writer] : output_hkfiles) {
+      writers[readout_hk_output(addr)] = {writer->Stats(), std::nullopt, writer->ChunksClosed()};
+    }
+    set_readout_writer_stats(std::move(writers), stream_stats(), setup->rotation.Enabled());
+    if (converter) {
+      set_readout_conversion_stats(converter->Stats());
+    }
+    if (quick_look) {
+      quick_look->SetDropped(quick_look_tap->Dropped());
+    }
+  };
 
   // Progress display runs on the main thread; it owns the shutdown sequence.
   auto start_time = std::chrono::steady_clock::now();
   mark_readout_started();
   while (std::chrono::steady_clock::now() - start_time < duration) {
     std::this_thread::sleep_for(std::chrono::seconds(1));
+    publish_writer_stats();
     // Interactive readout is a background job; emitting a carriage-return
     // progress line there would overwrite the user's current readline input.
     if (shell::stdout_is_tty() && !g_interactive_shell) {
-      std::map<uint8_t, size_t> counters_snapshot;
-      {
-        std::lock_guard<std::mutex> lock(frame_counter_mutex);
-        counters_snapshot = frame_counters;
-      }
+      const auto counters_snapshot = frames_written();
       size_t total_frames = 0;
       for (const auto& [addr, count] : counters_snapshot) {
         total_frames += count;
@@ -1717,11 +2600,18 @@ auto do_readout_foreground(const std::vector<std::string>& tokens,
       }
       break;
     }
-    if (reader_done.load(std::memory_order_relaxed)) {
+    const auto closed = std::find_if(streams.begin(), streams.end(), [](const auto& stream) {
+      return stream->done.load(std::memory_order_relaxed);
+    });
+    if (closed != streams.end()) {
       if (!g_interactive_shell && shell::stdout_is_tty()) {
         std::cout << "\n";
       }
-      emit_readout_message("Data stream closed by server before the requested duration.", true);
+      emit_readout_message(
+          "Data stream" +
+              readout_endpoint_suffix(*setup, static_cast<size_t>(closed - streams.begin())) +
+              " closed by server before the requested duration.",
+          true);
       readout_failed.store(true, std::memory_order_relaxed);
       break;
     }
@@ -1735,19 +2625,14 @@ auto do_readout_foreground(const std::vector<std::string>& tokens,
 
   bool stop_ok = true;
   {
-    ::superhero::StopDataStreamRequest stop_req;
-    ::superhero::StopDataStreamReply stop_rep;
-    ::grpc::ClientContext stop_context;
-    // Headroom over the server's own internal 5s stop timeout, so we receive
-    // its timeout message instead of a bare DEADLINE_EXCEEDED.
-    stop_context.set_deadline(std::chrono::system_clock::now() + std::chrono::seconds(7));
-    const auto stop_status = g_stub->StopDataStream(&stop_context, stop_req, &stop_rep);
-    if (!stop_status.ok()) {
-      emit_readout_message("Failed to stop data stream: " + stop_status.error_message(), true);
-      stop_ok = false;
-    } else if (!stop_rep.accepted()) {
-      emit_readout_message("Failed to stop data stream: " + stop_rep.message(), true);
-      stop_ok = false;
+    const auto errors = call_readout_endpoints(*setup, stop_data_stream);
+    for (size_t i = 0; i < errors.size(); ++i) {
+      if (!errors[i].empty()) {
+        emit_readout_message("Failed to stop data stream" + readout_endpoint_suffix(*setup, i) +
+                                 ": " + errors[i],
+                             true);
+        stop_ok = false;
+      }
     }
   }
 
@@ -1761,13 +2646,63 @@ auto do_readout_foreground(const std::vector<std::string>& tokens,
                          "the server may remain in observation mode.",
                          true);
   }
-  stream_context.TryCancel();
-  readout_thread.join();
+  for (auto& stream : streams) {
+    stream->context.TryCancel();
+  }
+  for (auto& stream : streams) {
+    stream->reader.join();
+  }
+
+  // Drain the rings, then flush and sync what is still buffered, so the files
+  // are complete before anything (pedcalib, a converter) reads them back.
+  for (const auto& [addr, file] : output_datafiles) {
+    file->Stop();
+  }
+  for (const auto& [addr, file] : output_hkfiles) {
+    file->Stop();
+  }
+  for (const auto& [addr, file] : output_datafiles) {
+    if (!file->Close()) {
+      emit_readout_message("Failed to close output file: " + file->Error(), true);
+      readout_failed.store(true, std::memory_order_relaxed);
+    }
+  }
+  for (const auto& [addr, file] : output_hkfiles) {
+    if (!file->Close()) {
+      emit_readout_message("Failed to close output file: " + file->Error(), true);
+      readout_failed.store(true, std::memory_order_relaxed);
+    }
+  }
+  if (quick_look_tap) {
+    quick_look_tap->Stop();
+  }
+  publish_writer_stats();
+
+  // The files closed last are still being converted. A stop request drops
+  // the conversions that have not started; running ones always complete.
+  if (converter) {
+    if (!converter->Idle() && !g_interactive_shell) {
+      const auto pending = converter->Stats();
+      emit_readout_message("Waiting for " + std::to_string(pending.queued + pending.running) +
+                           " conversion(s)...");
+    }
+    while (!converter->Idle()) {
+      if (g_readout_stop_requested.load(std::memory_order_relaxed) ||
+          g_interrupted.load(std::memory_order_relaxed)) {
+        converter->Cancel();
+      }
+      set_readout_conversion_stats(converter->Stats());
+      std::this_thread::sleep_for(100ms);
+    }
+    converter->Wait();
+    set_readout_conversion_stats(converter->Stats());
+  }
 
   // Final summary: the durable record of foreground/script acquisitions.
   // Interactive readout keeps this data for `readout status` instead, so a
   // background worker never writes over a readline prompt at completion.
   if (!g_interactive_shell) {
+    const auto frame_counters = frames_written();
     size_t total_frames = 0;
     for (const auto& [addr, count] : frame_counters) {
       total_frames += count;
@@ -1776,9 +2711,38 @@ auto do_readout_foreground(const std::vector<std::string>& tokens,
               << acquisition_elapsed.count() << "s\n";
     for (const auto& [addr, count] : frame_counters) {
       std::cout << "  " << shell::to_hex_string(addr) << ": " << count << " frames -> "
-                << file_prefix << "_" << shell::to_hex_string(addr) << "\n";
+                << readout_data_filename(file_prefix, addr, *setup);
+      if (rotating) {
+        std::cout << " (" << output_datafiles.at(addr)->ChunksClosed() << " chunks)";
+      }
+      std::cout << "\n";
+      std::cout << "    " << format_continuity(g_readout_continuity[addr].Load()) << "\n";
+      if (const auto stats = output_datafiles.at(addr)->Compression()) {
+        std::cout << "    " << format_compression_stats(*stats) << "\n";
+      }
     }
-    std::cout << "  HK -> " << hk_filename << "\n";
+    for (const auto& [addr, file] : output_hkfiles) {
+      std::cout << "  " << readout_hk_output(addr) << " -> "
+                << readout_hk_filename(file_prefix, addr, *setup);
+      if (rotating) {
+        std::cout << " (" << file->ChunksClosed() << " chunks)";
+      }
+      std::cout << "\n";
+    }
+    if (rotating) {
+      std::cout << "  Manifest: " << readout_manifest_filename(file_prefix) << "\n";
+    }
+    for (const auto& [endpoint, stream] : stream_stats()) {
+      std::cout << "  Stream" << (endpoint.empty() ? "" : " " + endpoint) << ": "
+                << format_stream_stats(stream) << "\n";
+    }
+    if (converter) {
+      std::cout << "  " << format_conversion_stats(converter->Stats()) << "\n";
+    }
+    if (quick_look) {
+      print_quick_look(*quick_look);
+    }
+    print_hk_monitor(*hk_monitor);
   }
 
   if (g_readout_stop_requested.load(std::memory_order_relaxed) ||
@@ -1788,71 +2752,168 @@ auto do_readout_foreground(const std::vector<std::string>& tokens,
   return stop_ok && !readout_failed.load(std::memory_order_relaxed);
 }
 
+struct PedcalibTarget {
+  std::string vareg_input;
+  std::string register_output;
+};
+
 struct PedcalibSetup {
   ReadoutSetup readout;
-  std::string calc_pedestal;
-  std::string set_delreg;
-  std::string vareg_input;
+  std::map<uint8_t, PedcalibTarget> targets;
 };
 
-auto prepare_pedcalib(const std::vector<std::string>& tokens) -> std::optional<PedcalibSetup> {
-  if (tokens.size() != 4) {
-    do_help({"help", "pedcalib_readout"});
-    return std::nullopt;
-  }
+// <register_output> for a single detector, <register_output>_0xNN for several.
+auto pedcalib_register_output(const std::string& register_output, uint8_t address,
+                              size_t detector_count) -> std::string {
+  return detector_count == 1 ? register_output
+                             : register_output + "_" + shell::to_hex_string(address);
+}
 
-  const auto calc_pedestal = find_auxiliary_file("calc_pedestal", true);
-  const auto set_delreg = find_auxiliary_file("set_delreg.py", false);
-  const bool calc_pedestal_ready =
-      calc_pedestal.has_value() &&
-      std::system((shell_quote(*calc_pedestal) + " --check >/dev/null 2>&1").c_str()) == 0;
-  const bool python_ready =
-      set_delreg.has_value() && std::system("command -v python3 >/dev/null 2>&1") == 0 &&
-      std::system(("python3 " + shell_quote(*set_delreg) + " --check >/dev/null 2>&1").c_str()) ==
-          0;
-  if (!calc_pedestal_ready || !python_ready) {
-    std::cerr << "pedcalib_readout requires an executable calc_pedestal and a Python "
-                 "environment able to run vareg.py. Build/activate them, then retry.\n";
-    return std::nullopt;
+auto pedcalib_register_summary(const PedcalibSetup& setup) -> std::string {
+  std::string summary;
+  for (const auto& [_, target] : setup.targets) {
+    summary += (summary.empty() ? "" : ", ") + target.register_output;
   }
+  return summary;
+}
 
-  if (g_last_set_vareg_path == "N/A" ||
-      !std::filesystem::is_regular_file(g_last_set_vareg_path)) {
-    std::cerr << "pedcalib_readout requires a readable VAREG file accepted by set_vareg first.\n";
+auto prepare_pedcalib(const std::vector<std::string>& tokens) -> std::optional<PedcalibSetup> {
+  if (tokens.size() < 4) {
+    do_help({"help", "pedcalib_readout"});
     return std::nullopt;
   }
-  const auto readout = prepare_readout({"readout", tokens[1], tokens[2]});
+
+  std::vector<std::string> readout_tokens = {"readout", tokens[1], tokens[2]};
+  readout_tokens.insert(readout_tokens.end(), tokens.begin() + 4, tokens.end());
+  const auto readout = prepare_readout(readout_tokens);
   if (!readout.has_value()) {
     return std::nullopt;
   }
-  if (readout->detector_addresses.size() != 1) {
-    std::cerr << "pedcalib_readout requires exactly one registered detector.\n";
+  if (readout->compression.enabled) {
+    // The raw files are read back by raw2root right after the readout.
+    std::cerr << "pedcalib_readout does not support compress=.\n";
     return std::nullopt;
   }
 
-  return PedcalibSetup{*readout, *calc_pedestal, *set_delreg, g_last_set_vareg_path};
+  const auto& addresses = readout->detector_addresses;
+  std::map<uint8_t, PedcalibTarget> targets;
+  for (const auto address : addresses) {
+    const auto accepted = g_set_vareg_paths.find(address);
+    // A single detector keeps accepting the last VAREG file uploaded to any address.
+    const std::string vareg_input =
+        accepted != g_set_vareg_paths.end()
+            ? accepted->second
+            : (addresses.size() == 1 ? g_last_set_vareg_path : std::string("N/A"));
+    if (vareg_input == "N/A" || !std::filesystem::is_regular_file(vareg_input)) {
+      std::cerr << "pedcalib_readout requires a readable VAREG file accepted by set_vareg "
+                   "first for "
+                << shell::to_hex_string(address) << ".\n";
+      return std::nullopt;
+    }
+    try {
+      (void)shell::vareg::Vareg4ASIC::Load(vareg_input);
+    } catch (const std::exception& e) {
+      std::cerr << "pedcalib_readout cannot use " << vareg_input << ": " << e.what() << "\n";
+      return std::nullopt;
+    }
+    targets[address] = {vareg_input,
+                         pedcalib_register_output(tokens[3], address, addresses.size())};
+  }
+
+  return PedcalibSetup{*readout, targets};
 }
 
 auto do_pedcalib_readout_foreground(const std::vector<std::string>& tokens,
                                     const PedcalibSetup& setup) -> bool {
-  if (!do_readout_foreground({"readout", tokens[1], tokens[2]}, setup.readout)) {
+  // Frames are decoded into the pedestal histograms while they are written,
+  // so the tables are ready as soon as acquisition stops.
+  auto online = std::make_shared<OnlinePedestal>(setup.readout.detector_addresses);
+  set_readout_online_pedestal(online);
+  FrameTap tap([&online](uint8_t address, std::string_view frame) {
+    online->AddFrame(address, frame);
+  });
+  const bool readout_ok = do_readout_foreground({"readout", tokens[1], tokens[2]},
+                                                setup.readout, &tap);
+  tap.Stop();
+  uint64_t corrupt_frames = tap.Failed();
+  for (const auto& detector : online->Summary()) {
+    corrupt_frames += detector.decode_errors;
+  }
+  if (corrupt_frames > 0) {
+    emit_readout_message("Online pedestal stopped decoding " + std::to_string(corrupt_frames) +
+                             " corrupt frame(s) early",
+                         true);
+  }
+  if (!readout_ok) {
     return false;
   }
 
   const auto status = readout_status_snapshot();
-  const std::string raw_file =
-      status.file_prefix + "_" + shell::to_hex_string(setup.readout.detector_addresses.front());
-  emit_readout_message("Calculating median pedestals...");
-  const std::string command = shell_quote(setup.calc_pedestal) + " " + shell_quote(raw_file) +
-                              " 2>/dev/null | python3 " + shell_quote(setup.set_delreg) + " --in " +
-                              shell_quote(setup.vareg_input) + " --out " + shell_quote(tokens[3]) +
-                              " >/dev/null 2>&1";
-  if (std::system(command.c_str()) != 0) {
-    emit_readout_message("Pedestal register generation failed for " + raw_file, true);
-    return false;
-  }
-  emit_readout_message("Pedestal register written to " + tokens[3]);
-  return true;
+  std::map<uint8_t, ChannelTable> tables;
+  if (tap.Dropped() == 0) {
+    for (const auto& [address, _] : setup.targets) {
+      if (const auto table = online->Table(address)) {
+        tables[address] = *table;
+      }
+    }
+  } else {
+    emit_readout_message("Online pedestal skipped " + std::to_string(tap.Dropped()) +
+                         " frames; re-reading the raw files");
+  }
+
+  // Anything the online pass could not complete goes through the same engine
+  // as calc_pedestal, one thread per detector.
+  std::vector<DetectorPedestal> detectors;
+  for (const auto& [address, _] : setup.targets) {
+    if (tables.count(address) == 0) {
+      // Every chunk of a rotated output, in order.
+      const auto& writers = status.transfer->writers;
+      const auto writer = writers.find(shell::to_hex_string(address));
+      const uint32_t chunks = writer != writers.end() ? writer->second.chunks : 0;
+      std::vector<std::string> files;
+      for (uint32_t chunk = 0; chunk < std::max<uint32_t>(chunks, 1); ++chunk) {
+        files.push_back(readout_data_filename(status.file_prefix, address, setup.readout, chunk));
+      }
+      detectors.push_back({shell::to_hex_string(address), files, nullptr, "", nullptr});
+    }
+  }
+  if (!detectors.empty()) {
+    emit_readout_message("Calculating median pedestals for " + std::to_string(detectors.size()) +
+                         " detector(s)...");
+    compute_pedestals(detectors, PedestalSink::kUnlimited, detectors.size());
+  }
+
+  bool success = true;
+  auto detector = detectors.begin();
+  for (const auto& [address, target] : setup.targets) {
+    const std::string raw_file = status.file_prefix + "_" + shell::to_hex_string(address);
+    try {
+      if (tables.count(address) == 0) {
+        const auto& result = *detector++;
+        if (!result.error.empty()) {
+          throw std::runtime_error(result.error);
+        }
+        tables[address] = result.pedestal->Table();
+      }
+      const auto& pedestals = tables.at(address);
+      // Keep the table next to the raw file, as calc_pedestal --output would.
+      std::ofstream table(raw_file + ".pedestal");
+      write_channel_table(table, pedestals);
+
+      auto vareg = shell::vareg::Vareg4ASIC::Load(target.vareg_input);
+      shell::vareg::trim_del_reg(vareg, pedestals);
+      vareg.Save(target.register_output);
+    } catch (const std::exception& e) {
+      emit_readout_message("Pedestal register generation failed for " + raw_file + ": " +
+                               e.what(),
+                           true);
+      success = false;
+      continue;
+    }
+    emit_readout_message("Pedestal register for " + shell::to_hex_string(address) +
+                         " written to " + target.register_output);
+  }
+  return success;
 }
 
 namespace {
@@ -1868,23 +2929,48 @@ void join_completed_readout_locked() {
 
 }  // namespace
 
+// Convergence of the live pedestal tables: sample counts per channel and the
+// largest median change between the last two checks.
+void print_online_pedestal(const OnlinePedestal& online) {
+  std::cout << "  Pedestal convergence (median shift over the last "
+            << OnlinePedestal::kCheckInterval << " events):\n";
+  for (const auto& detector : online.Summary()) {
+    std::cout << "    " << shell::to_hex_string(detector.address) << ": " << detector.events
+              << " events | samples/channel " << detector.min_samples << ".."
+              << detector.max_samples;
+    if (detector.empty_channels > 0) {
+      std::cout << " (" << detector.empty_channels << " empty)";
+    }
+    std::cout << " | median shift ";
+    if (detector.median_shift) {
+      std::cout << *detector.median_shift;
+    } else {
+      std::cout << "n/a";
+    }
+    if (detector.decode_errors > 0) {
+      std::cout << " | " << detector.decode_errors << " corrupt frames";
+    }
+    std::cout << "\n";
+  }
+}
+
 auto readout_prompt_progress() -> std::optional<std::string> {
   if (!g_readout_active.load(std::memory_order_relaxed)) {
     return std::nullopt;
   }
 
-  const auto status = readout_status_snapshot();
-  if (status.duration <= std::chrono::nanoseconds::zero()) {
+  const auto timing = g_readout_timing.Load();
+  if (timing.duration <= std::chrono::nanoseconds::zero()) {
     return std::nullopt;
   }
 
-  auto remaining = status.duration;
-  if (status.started) {
-    const auto elapsed = std::chrono::steady_clock::now() - status.start_time;
-    remaining = elapsed < status.duration ? status.duration - elapsed
+  auto remaining = timing.duration;
+  if (timing.started) {
+    const auto elapsed = std::chrono::steady_clock::now() - timing.start_time;
+    remaining = elapsed < timing.duration ? timing.duration - elapsed
                                           : std::chrono::nanoseconds::zero();
   }
-  return format_prompt_duration(remaining) + "/" + format_prompt_duration(status.duration);
+  return format_prompt_duration(remaining) + "/" + format_prompt_duration(timing.duration);
 }
 
 auto do_readout(const std::vector<std::string>& tokens) -> bool {
@@ -1926,14 +3012,55 @@ auto do_readout(const std::vector<std::string>& tokens) -> bool {
       std::cout << "  Output prefix: " << status.file_prefix << "\n";
     }
     for (const auto& [addr, count] : status.frame_counters) {
-      std::cout << "  " << shell::to_hex_string(addr) << ": " << count << " frames\n";
+      std::cout << "  " << shell::to_hex_string(addr) << ": " << count << " frames | "
+                << format_continuity(status.continuity.at(addr)) << "\n";
     }
-    if (!status.hk_filename.empty()) {
-      std::cout << "  HK: " << status.hk_filename << "\n";
+    for (const auto& [output, filename] : status.hk_filenames) {
+      std::cout << "  " << output << ": " << filename << "\n";
     }
     if (!status.register_filename.empty()) {
       std::cout << "  Register output: " << status.register_filename << "\n";
     }
+    const auto& transfer = *status.transfer;
+    for (const auto& [endpoint, stream] : transfer.streams) {
+      std::cout << "  Stream" << (endpoint.empty() ? "" : " " + endpoint) << ": "
+                << format_stream_stats(stream) << "\n";
+    }
+    for (const auto& [name, writer] : transfer.writers) {
+      if (writer.compression) {
+        std::cout << "  Compression " << name << ": "
+                  << format_compression_stats(*writer.compression) << "\n";
+      }
+    }
+    if (status.conversions) {
+      std::cout << "  " << format_conversion_stats(*status.conversions) << "\n";
+    }
+    if (transfer.rotating) {
+      std::cout << "  Completed chunks (" << readout_manifest_filename(status.file_prefix)
+                << "):";
+      for (const auto& [name, writer] : transfer.writers) {
+        std::cout << " " << name << " " << writer.chunks;
+      }
+      std::cout << "\n";
+    }
+    if (!transfer.writers.empty()) {
+      std::cout << "  Write rings (frames queued/capacity, high water, full waits):\n";
+      for (const auto& [name, writer] : transfer.writers) {
+        const auto& ring = writer.ring;
+        std::cout << "    " << name << ": " << ring.used << "/" << ring.capacity
+                  << " | high water " << ring.high_water << " | full waits "
+                  << ring.full_waits << "\n";
+      }
+    }
+    if (status.online_pedestal) {
+      print_online_pedestal(*status.online_pedestal);
+    }
+    if (status.quick_look) {
+      print_quick_look(*status.quick_look);
+    }
+    if (status.hk_monitor) {
+      print_hk_monitor(*status.hk_monitor);
+    }
     if (!status.messages.empty()) {
       std::cout << "  Messages:\n";
       for (const auto& message : status.messages) {
@@ -1959,7 +3086,7 @@ auto do_readout(const std::vector<std::string>& tokens) -> bool {
   if (!g_interactive_shell) {
     return do_readout_foreground(tokens);
   }
-  if (tokens.size() != 3) {
+  if (tokens.size() < 3) {
     do_help({"help", "readout"});
     return false;
   }
@@ -1976,7 +3103,8 @@ auto do_readout(const std::vector<std::string>& tokens) -> bool {
   }
   const auto file_prefix = readout_file_prefix(tokens[2], *setup);
   reset_readout_status(setup->duration);
-  set_readout_outputs(file_prefix, file_prefix + "_hk", setup->detector_addresses);
+  set_readout_outputs(file_prefix, readout_hk_filenames(file_prefix, *setup),
+                      setup->detector_addresses);
   g_readout_stop_requested.store(false, std::memory_order_relaxed);
   g_readout_active.store(true, std::memory_order_relaxed);
   g_readout_worker = std::thread([tokens, setup = *setup]() {
@@ -2000,7 +3128,7 @@ auto do_pedcalib_readout(const std::vector<std::string>& tokens) -> bool {
       return false;
     }
     reset_readout_status(setup->readout.duration, "pedcalib_readout");
-    set_readout_register_output(tokens[3]);
+    set_readout_register_output(pedcalib_register_summary(*setup));
     g_readout_stop_requested.store(false, std::memory_order_relaxed);
     const bool success = do_pedcalib_readout_foreground(tokens, *setup);
     finish_readout_status(success, g_readout_stop_requested.load(std::memory_order_relaxed));
@@ -2021,8 +3149,9 @@ auto do_pedcalib_readout(const std::vector<std::string>& tokens) -> bool {
 
   const auto file_prefix = readout_file_prefix(tokens[2], setup->readout);
   reset_readout_status(setup->readout.duration, "pedcalib_readout");
-  set_readout_outputs(file_prefix, file_prefix + "_hk", setup->readout.detector_addresses);
-  set_readout_register_output(tokens[3]);
+  set_readout_outputs(file_prefix, readout_hk_filenames(file_prefix, setup->readout),
+                      setup->readout.detector_addresses);
+  set_readout_register_output(pedcalib_register_summary(*setup));
   g_readout_stop_requested.store(false, std::memory_order_relaxed);
   g_readout_active.store(true, std::memory_order_relaxed);
   g_readout_worker = std::thread([tokens, setup = *setup]() {
@@ -2032,7 +3161,57 @@ auto do_pedcalib_readout(const std::vector<std::string>& tokens) -> bool {
   });
   std::cout << "Pedestal calibration started in the background. Use 'pedcalib_readout status' "
                "or 'pedcalib_readout stop'.\n";
-  print_readout_outputs(file_prefix, setup->readout, tokens[3]);
+  print_readout_outputs(file_prefix, setup->readout, pedcalib_register_summary(*setup));
+  return true;
+}
+
+auto do_quicklook(const std::vector<std::string>& tokens) -> bool {
+  if (tokens.size() > 3 || (tokens.size() == 3 && tokens[1] != "dump")) {
+    do_help({"help", "quicklook"});
+    return false;
+  }
+  const auto quick_look = readout_quick_look();
+  if (!quick_look) {
+    std::cout << "No quick-look data. Start a readout with quicklook=N or quicklook=all.\n";
+    return false;
+  }
+
+  if (tokens.size() == 1) {
+    print_quick_look(*quick_look);
+    return true;
+  }
+  if (tokens.size() == 3) {
+    bool ok = true;
+    for (const auto& detector : quick_look->Summary()) {
+      const auto base = tokens[2] + "_" + shell::to_hex_string(detector.address);
+      std::ofstream channels(base + ".channels");
+      std::ofstream spectra(base + ".spectra");
+      if (!channels.is_open() || !spectra.is_open()) {
+        std::cerr << "Cannot write " << base << ".channels/.spectra\n";
+        ok = false;
+        continue;
+      }
+      quick_look->WriteChannelMap(detector.address, channels);
+      quick_look->WriteSpectra(detector.address, spectra);
+      std::cout << "Wrote " << base << ".channels and " << base << ".spectra\n";
+    }
+    return ok;
+  }
+
+  uint8_t address = 0;
+  try {
+    address = static_cast<uint8_t>(shell::parse_uint8(tokens[1]));
+  } catch (const std::exception& e) {
+    std::cerr << "Invalid logical address " << tokens[1] << ": " << e.what() << "\n";
+    return false;
+  }
+  std::ostringstream map;
+  if (!quick_look->WriteChannelMap(address, map)) {
+    std::cerr << "No quick-look data for " << shell::to_hex_string(address) << ".\n";
+    return false;
+  }
+  print_quick_look(*quick_look);
+  std::cout << map.str();
   return true;
 }
 
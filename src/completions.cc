@@ -252,6 +252,19 @@ auto readout_action_completion(const char* text) -> char** {
   return rl_completion_matches(text, completion_generator);
 }
 
+auto endpoint_completion(const char* text, bool with_remove) -> char** {
+  for (const auto& [name, _] : g_endpoints) {
+    if (name.find(text) == 0) {
+      g_candidate.emplace_back(name);
+    }
+  }
+  if (with_remove && std::string_view("remove").find(text) == 0) {
+    g_candidate.emplace_back("remove");
+  }
+  rl_attempted_completion_over = 1;
+  return rl_completion_matches(text, completion_generator);
+}
+
 auto command_completion(const char* text) -> char** {
   for (const auto& info : kCommands) {
     if (command_available(info) && info.name.find(text) == 0) {
@@ -314,6 +327,11 @@ auto repl_completion(const char* text, int start, int end) -> char** {
       return set_get_device_completion(text);
     }
 
+    if ((arg_index_is(1) || arg_index_is(2) || arg_index_is(3)) &&
+        command == "disable_channels") {
+      return rl_completion_matches(text, rl_filename_completion_function);
+    }
+
     if (arg_index_is(2) && command == "set_vareg") {
       return rl_completion_matches(text, rl_filename_completion_function);
     }
@@ -329,6 +347,13 @@ auto repl_completion(const char* text, int start, int end) -> char** {
       return rl_completion_matches(text, rl_filename_completion_function);
     }
 
+    if (arg_index_is(1) && command == "endpoint") {
+      return endpoint_completion(text, true);
+    }
+    if (arg_index_is(2) && command == "endpoint" && current_command[1] == "remove") {
+      return endpoint_completion(text, false);
+    }
+
     if (arg_index_is(1) && command == "set_linkspeed") {
       return link_speed_completion(text);
     }
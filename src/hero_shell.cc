@@ -28,9 +28,11 @@ std::atomic<bool> g_readout_stop_requested{false};
 bool g_interactive_shell = false;
 std::thread::id g_shell_thread_id{};
 std::shared_ptr<grpc::Channel> g_channel = nullptr;
-std::unique_ptr<superhero::CommunicationService::Stub> g_stub = nullptr;
+std::shared_ptr<superhero::CommunicationService::Stub> g_stub = nullptr;
 ShellState g_current_state = ShellState::IDLE;
 std::string g_current_endpoint{};
+std::string g_current_endpoint_name{};
+std::map<std::string, Endpoint> g_endpoints{};
 int g_router_count = 0;
 int g_detector_count = 0;
 std::vector<std::string> g_candidate{};
@@ -41,7 +43,7 @@ const std::vector<ShellState> kConnectedStates = {ShellState::CONNECTED, ShellSt
 const std::vector<ShellState> kDeviceStates = {ShellState::DEVICE_ADDED};
 const std::vector<std::string> kReadoutSafeCommands = {
     "help", "sleep", "set", "get", "show", "list_devices", "list_detectors", "list_routers",
-    "reconnect_device", "readout", "pedcalib_readout", "exit", "quit"};
+    "reconnect_device", "readout", "pedcalib_readout", "quicklook", "endpoint", "exit", "quit"};
 
 auto command_safe_during_readout(const std::string& name) -> bool {
   return std::find(kReadoutSafeCommands.begin(), kReadoutSafeCommands.end(), name) !=
@@ -54,7 +56,8 @@ const std::vector<CommandInfo> kCommands = {
      R"(Usage: help [command]
   Show the list of available commands, or details for one command.
   Typical workflow:
-    1. connect <host:port> to open the gRPC channel to CdTeDE.
+    1. connect <host:port> to open the gRPC channel to CdTeDE
+       (connect <host:port> <name> once per server for several servers).
     2. add_detector <logical> <target...> - <reply...> to register the detector path.
     3. set <parameter> <logical> <value> to configure detector parameters.
     4. readout <duration> <output_prefix> to capture frames.
@@ -70,11 +73,24 @@ const std::vector<CommandInfo> kCommands = {
     {"quit", "General", kAllStates, "Terminate the shell",
      "Usage: quit\n  Terminate the shell. 'exit' is an alias."},
 
-    {"connect", "Connection", {ShellState::IDLE}, "Open the gRPC channel to the server",
-     R"(Usage: connect <host:port>
-  Open the gRPC channel to the CdTeDE server.
+    {"connect", "Connection", kAllStates, "Open the gRPC channel to a server",
+     R"(Usage: connect <host:port> [name]
+  Open the gRPC channel to a CdTeDE server and make it the current endpoint.
+  Each server of a multi-bridge stack is connected under its own name
+  (letters, digits, '-' and '_'; default "default"); device and configuration
+  commands act on the current endpoint, and readout streams from all of them.
+  A name that is already connected is rejected; use endpoint remove first.
   Ctrl-C cancels a pending connection attempt.
-  Example: connect localhost:50051)"},
+  Example: connect 192.168.1.10:50051 top)"},
+    {"endpoint", "Connection", kAllStates, "List or switch the connected servers",
+     R"(Usage: endpoint
+       endpoint <name>
+       endpoint remove <name>
+  Without arguments, list the connected endpoints and their detectors; '*'
+  marks the current one. endpoint <name> makes that endpoint current for
+  device and configuration commands. endpoint remove <name> closes it; it is
+  rejected during acquisition, which streams from the endpoints it started with.
+  Example: endpoint bottom)"},
 
     {"add_detector", "Device Management", kConnectedStates,
      "Register a detector by logical address",
@@ -132,6 +148,14 @@ const std::vector<CommandInfo> kCommands = {
      R"(Usage: set_vareg <logical> <filename>
   Upload a base64-encoded VAREG image (516 bytes decoded, CRC32-checked) to a detector.
   Example: set_vareg 0x35 vareg_default.b64)"},
+    {"disable_channels", "Configuration", kAllStates,
+     "Set CH_Disable in a VAREG image from a channel map",
+     R"(Usage: disable_channels <vareg_in> <channel_map> <vareg_out> [status=LIST]
+  Copy a VAREG image with CH_Disable set for every channel of a channel map
+  (calc_pedestal --channel-map, raw2root --sinks channels or quicklook dump)
+  whose status is in LIST (default dead,stuck,noisy,hot). Other channels keep
+  their CH_Disable bit. Works on files only; upload the result with set_vareg.
+  Example: disable_channels current.b64 run_0x35.channels disabled.b64 status=dead,hot)"},
     {"set_linkspeed", "Configuration", kConnectedStates, "Change the SpaceWire link speed",
      R"(Usage: set_linkspeed <10MHz|20MHz|25MHz|33MHz|50MHz|100MHz>
   Change the SpaceWire link speed.
@@ -139,28 +163,72 @@ const std::vector<CommandInfo> kCommands = {
     {"show", "Data Acquisition", kDeviceStates, "Dump status/timing registers",
      "Usage: show <logical>\n  Dump the common status/timing registers for a device."},
     {"readout", "Data Acquisition", kDeviceStates, "Start/stop HL data streaming",
-     R"(Usage: readout <duration> <output_file_prefix>
+     R"(Usage: readout <duration> <output_file_prefix> [key=value...]
        readout status
        readout stop
-  Start HL data streaming for <duration>, writing per-detector and HK files.
+  Start HL data streaming for <duration>, writing a data file <prefix>_0xNN and
+  an HK file <prefix>_hk_0xNN per detector.
+  With several endpoints connected, all of them stream at once under one run
+  prefix.
   In an interactive shell, readout runs in the background so `set`, `get`, `show`,
   and device-list commands remain available. Use `readout status` to inspect it or
   `readout stop` to stop it early. Status shows output paths, frame counts,
-  elapsed/remaining time, and deferred worker diagnostics.
+  event-counter gaps, elapsed/remaining time, stream rate, writer ring fill,
+  compression ratio, conversion progress, the latest HK values, and deferred
+  worker diagnostics.
   <duration> accepts combined units, e.g. 10s, 90min, 1h30min.
-  Example: readout 1h30min run001)"},
+  Output is buffered; options (sizes take K/M/G, "off" disables a trigger):
+    buffer=SIZE        write buffer per file (default 8M)
+    flush=DURATION     hand buffered data to the kernel after this (default 1s)
+    sync=DURATION      fdatasync after this since the last sync (default 5s)
+    sync_bytes=SIZE    fdatasync after this many bytes (default off)
+    ring=FRAMES        frames queued per writer thread (default 512)
+    quicklook=N|all    decode one in N data frames for `quicklook` (default off)
+    preallocate=RATE   reserve disk space ahead of the data at RATE bytes/s per
+                       detector, or `on` for the measured rate (default off)
+    direct=on          bypass the page cache with O_DIRECT (default off)
+  Data files can be zstd-compressed (seekable format, .zst suffix) when built
+  with zstd:
+    compress=LEVEL     compression level, -7 to 22 (default off)
+    compress_frames=N  data frames per zstd frame (default 32)
+    compress_threads=N zstd workers per file (default 0: the writer thread)
+  Outputs can roll into numbered chunks, listed in <prefix>_manifest.txt once
+  complete (default off; the first limit reached starts a new chunk):
+    chunk_frames=N     frames per chunk
+    chunk_bytes=SIZE   raw bytes per chunk
+    chunk_time=DURATION  time per chunk
+  Completed data files or chunks can be converted with raw2root meanwhile, at
+  nice 19 and idle I/O priority (default off):
+    convert=JOBS       conversions run at once
+    convert_args=ARGS  raw2root options, e.g. convert_args="--sinks tree,rate"
+  Example: readout 1h30min run001 buffer=16M sync=10s)"},
     {"pedcalib_readout", "Data Acquisition", kDeviceStates,
      "Acquire pedestal data and generate a calibrated VAREG image",
-     R"(Usage: pedcalib_readout <duration> <output_file_prefix> <register_output>
+     R"(Usage: pedcalib_readout <duration> <output_file_prefix> <register_output> [key=value...]
        pedcalib_readout status
        pedcalib_readout stop
-  Acquire pedestal data from exactly one detector, calculate per-channel
-  median ADC-CMN pedestals, and write a copy of the last
-  accepted VAREG image with calibrated Del_reg values.
+  Acquire pedestal data from every registered detector, calculate
+  per-channel median ADC-CMN pedestals (one thread per detector), and write
+  a copy of each detector's last accepted VAREG image with calibrated
+  Del_reg values. With several detectors the images are written to
+  <register_output>_0xNN.
   In an interactive shell, acquisition runs in the background. Status reports
   the raw/HK paths, frame counts, register output, and calibration messages.
-  Requires calc_pedestal and a Python environment for vareg.py.
+  Pedestals and VAREG images are computed in-process; no helper programs
+  are needed. key=value options are the readout output options.
   Example: pedcalib_readout 100sec output reg_output)"},
+    {"quicklook", "Data Acquisition", kAllStates, "Show live quick-look histograms of a readout",
+     R"(Usage: quicklook
+       quicklook <logical>
+       quicklook dump <prefix>
+  Show the quick-look histograms of the running or last readout started with
+  quicklook=N (decode one in N data frames) or quicklook=all. Without
+  arguments: decoded frames, events, event rate, hits per ASIC and the dead,
+  stuck, noisy and hot channels of every detector. With <logical>: also the
+  per-channel map of that detector. dump writes <prefix>_0xNN.channels (the
+  raw2root channel map, usable by disable_channels) and <prefix>_0xNN.spectra
+  (ADC and ADC-CMN spectra, one line per non-empty bin). Available during readout.
+  Example: quicklook 0x35)"},
 };
 
 auto find_command(const std::string& name) -> const CommandInfo* {
@@ -318,10 +386,15 @@ auto get_detector_logical_addresses() -> std::optional<std::vector<uint8_t>> {
   if (!g_stub) {
     return std::nullopt;
   }
+  return get_detector_logical_addresses(*g_stub);
+}
+
+auto get_detector_logical_addresses(superhero::CommunicationService::Stub& stub)
+    -> std::optional<std::vector<uint8_t>> {
   grpc::ClientContext context;
   superhero::GetDetectorListRequest request;
   superhero::GetDetectorListReply reply;
-  auto status = g_stub->GetDetectorList(&context, request, &reply);
+  auto status = stub.GetDetectorList(&context, request, &reply);
   log_grpc_error("GetDetectorList", status);
   if (!status.ok()) {
     return std::nullopt;
@@ -405,6 +478,7 @@ void refresh_state_after_device_change() {
   if (!g_stub) {
     g_current_state = ShellState::IDLE;
     g_current_endpoint.clear();
+    g_current_endpoint_name.clear();
     return;
   }
   if (g_detector_count > 0 || g_router_count > 0) {
@@ -414,6 +488,21 @@ void refresh_state_after_device_change() {
   }
 }
 
+// Makes a connected endpoint current, or disconnects when name is unknown.
+void use_endpoint(const std::string& name) {
+  const auto found = g_endpoints.find(name);
+  if (found == g_endpoints.end()) {
+    g_channel = nullptr;
+    g_stub = nullptr;
+  } else {
+    g_channel = found->second.channel;
+    g_stub = found->second.stub;
+    g_current_endpoint = found->second.target;
+    g_current_endpoint_name = name;
+  }
+  refresh_state_after_device_change();
+}
+
 auto build_prompt() -> PromptInfo {
   auto wrap_nonprinting = [](const char* code) -> std::string {
     std::string result;
@@ -452,7 +541,11 @@ auto build_prompt() -> PromptInfo {
   const auto readout_progress = readout_prompt_progress();
   const std::string progress_suffix =
       readout_progress ? "[" + *readout_progress + "]" : std::string();
-  std::string plain_prompt = "hero_shell[" + g_current_endpoint + "(" +
+  // With several servers connected, the name tells which one commands reach.
+  const std::string endpoint = g_endpoints.size() > 1
+                                   ? g_current_endpoint_name + "@" + g_current_endpoint
+                                   : g_current_endpoint;
+  std::string plain_prompt = "hero_shell[" + endpoint + "(" +
                              std::to_string(g_router_count) + "," +
                              std::to_string(g_detector_count) + ")]" + progress_suffix + "> ";
   prompt.visible_length = plain_prompt.size();
@@ -461,11 +554,11 @@ auto build_prompt() -> PromptInfo {
     prompt.readline_text = plain_prompt;
     return prompt;
   }
-  prompt.display_text = bold_on_display + "hero_shell[" + g_current_endpoint + "(" +
+  prompt.display_text = bold_on_display + "hero_shell[" + endpoint + "(" +
                         router_color_display + std::to_string(g_router_count) + bold_off_display +
                         "," + detector_color_display + std::to_string(g_detector_count) +
                         bold_off_display + ")]" + progress_suffix + "> ";
-  prompt.readline_text = bold_on_readline + "hero_shell[" + g_current_endpoint + "(" +
+  prompt.readline_text = bold_on_readline + "hero_shell[" + endpoint + "(" +
                          router_color_readline + std::to_string(g_router_count) +
                          bold_off_readline + "," + detector_color_readline +
                          std::to_string(g_detector_count) + bold_off_readline + ")]" +
@@ -552,6 +645,9 @@ auto execute_command(const std::string& line, int depth) -> bool {
   if (tokens[0] == "connect") {
     return do_connect(tokens);
   }
+  if (tokens[0] == "endpoint") {
+    return do_endpoint(tokens);
+  }
 
   if (tokens[0] == "add_detector") {
     return do_add_detector(tokens);
@@ -598,6 +694,9 @@ auto execute_command(const std::string& line, int depth) -> bool {
   if (tokens[0] == "set_vareg") {
     return do_set_vareg(tokens);
   }
+  if (tokens[0] == "disable_channels") {
+    return do_disable_channels(tokens);
+  }
   if (tokens[0] == "show") {
     return do_show(tokens);
   }
@@ -607,6 +706,9 @@ auto execute_command(const std::string& line, int depth) -> bool {
   if (tokens[0] == "pedcalib_readout") {
     return do_pedcalib_readout(tokens);
   }
+  if (tokens[0] == "quicklook") {
+    return do_quicklook(tokens);
+  }
   if (tokens[0] == "set_linkspeed") {
     return do_set_linkspeed(tokens);
   }
@@ -0,0 +1,217 @@
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "hk_frame.hh"
+#include "run_files.hh"
+
+namespace {
+
+void print_usage(const std::string& program) {
+  std::cerr << "Usage: " << program << " [--output DIR | --tsv] input...\n"
+            << "  input is an HK file or a run prefix (every <prefix>_hk_0xNN file\n"
+            << "  or <prefix>_hk_0xNN_NNNNNN chunk).\n"
+            << "  Decodes the 1024-byte HK frames through the HK field table into\n"
+            << "  one column per field. The chunks of one detector of one run form a\n"
+            << "  single series, written to <prefix>_hk_0xNN.hkcol/, or DIR/0xNN/\n"
+            << "  with --output, which then takes one run per logical address.\n"
+            << "  A column is <field>.u32 or <field>.u64, the raw values as\n"
+            << "  little-endian integers, one per frame; columns.txt lists each\n"
+            << "  field with its type, scale and unit.\n"
+            << "  --tsv prints a header line and one row per frame instead, the\n"
+            << "  first column naming the detector.\n";
+}
+
+// One output file per field, appended to frame by frame.
+class ColumnWriter {
+ public:
+  explicit ColumnWriter(const std::filesystem::path& directory) {
+    std::filesystem::create_directories(directory);
+    std::ofstream schema(directory / "columns.txt");
+    if (!schema.is_open()) {
+      throw std::runtime_error("Could not open output file " +
+                               (directory / "columns.txt").string());
+    }
+    schema << "# name type scale unit\n";
+    for (const auto& field : hk_frame::kFields) {
+      const std::string type = field.type == hk_frame::FieldType::kU64 ? "u64" : "u32";
+      schema << field.name << " " << type << " " << field.scale << " "
+             << (field.unit.empty() ? "-" : field.unit) << "\n";
+      const auto path = directory / (std::string(field.name) + "." + type);
+      auto& column = columns_.emplace_back(std::make_unique<std::ofstream>(
+          path, std::ios::binary | std::ios::trunc));
+      if (!column->is_open()) {
+        throw std::runtime_error("Could not open output file " + path.string());
+      }
+    }
+  }
+
+  void Write(const hk_frame::Values& values) {
+    for (size_t i = 0; i < hk_frame::kFields.size(); ++i) {
+      const auto size = hk_frame::field_bytes(hk_frame::kFields[i].type);
+      std::array<char, 8> bytes{};
+      for (size_t byte = 0; byte < size; ++byte) {
+        bytes[byte] = static_cast<char>((values[i] >> (8 * byte)) & 0xFF);  // NOLINT
+      }
+      columns_[i]->write(bytes.data(), static_cast<std::streamsize>(size));
+    }
+  }
+
+  void Close() {
+    for (auto& column : columns_) {
+      column->close();
+      if (column->fail()) {
+        throw std::runtime_error("Failed to write an HK column");
+      }
+    }
+  }
+
+ private:
+  std::vector<std::unique_ptr<std::ofstream>> columns_;
+};
+
+void write_tsv_header(std::ostream& output) {
+  output << "address";
+  for (const auto& field : hk_frame::kFields) {
+    output << "\t" << field.name;
+  }
+  output << "\n";
+}
+
+void write_tsv_row(std::ostream& output, const std::string& key, const hk_frame::Values& values) {
+  output << key;
+  for (size_t i = 0; i < values.size(); ++i) {
+    output << "\t";
+    hk_frame::write_value(output, hk_frame::kFields[i], values[i]);
+  }
+  output << "\n";
+}
+
+// The series a file belongs to: the file name without a _NNNNNN chunk suffix,
+// so run_hk_0x35_000003 gives run_hk_0x35.
+auto series_path(const std::string& file) -> std::string {
+  const auto underscore = file.rfind('_');
+  if (underscore != std::string::npos && file.size() - underscore == 7 &&
+      std::all_of(file.begin() + static_cast<std::ptrdiff_t>(underscore) + 1, file.end(),
+                  [](unsigned char c) { return std::isdigit(c) != 0; }) &&
+      detector_key(file.substr(0, underscore)) == detector_key(file)) {
+    return file.substr(0, underscore);
+  }
+  return file;
+}
+
+// Decodes every whole frame of path; a trailing partial frame is reported
+// and skipped. Returns the number of frames.
+template <typename Sink>
+auto convert_file(const std::string& path, Sink&& sink) -> uint64_t {
+  std::ifstream input(path, std::ios::binary);
+  if (!input.is_open()) {
+    throw std::runtime_error("Could not open input file " + path);
+  }
+  std::array<char, hk_frame::kFrameBytes> frame{};
+  uint64_t frames = 0;
+  while (input.read(frame.data(), frame.size())) {
+    sink(hk_frame::decode(frame.data()));
+    ++frames;
+  }
+  if (input.gcount() > 0) {
+    std::cerr << "Warning: " << path << ": ignoring " << input.gcount()
+              << " trailing bytes of a partial frame\n";
+  }
+  return frames;
+}
+
+}  // namespace
+
+auto main(int argc, char** argv) -> int try {
+  const std::vector<std::string> args(argv, argv + argc);  // NOLINT
+  if (args.size() == 2 && args[1] == "--check") {
+    return 0;
+  }
+
+  std::string output_directory;
+  bool tsv = false;
+  std::vector<std::string> inputs;
+  for (size_t i = 1; i < args.size(); ++i) {
+    if (args[i] == "--output" && i + 1 < args.size()) {
+      output_directory = args[++i];
+    } else if (args[i] == "--tsv") {
+      tsv = true;
+    } else if (args[i].rfind("--", 0) != 0) {
+      inputs.push_back(args[i]);
+    } else {
+      print_usage(args.front());
+      return 1;
+    }
+  }
+  if (inputs.empty() || (tsv && !output_directory.empty())) {
+    print_usage(args.front());
+    return 1;
+  }
+
+  // One series per run and logical address, its files (chunks) in name order.
+  std::map<std::string, std::vector<std::string>> files_by_series;
+  for (const auto& input : inputs) {
+    for (const auto& file : expand_run_input(input, "_hk")) {
+      files_by_series[series_path(file)].push_back(file);
+    }
+  }
+  for (auto& [series, files] : files_by_series) {
+    std::sort(files.begin(), files.end());
+    files.erase(std::unique(files.begin(), files.end()), files.end());
+  }
+  if (!output_directory.empty()) {
+    std::map<std::string, std::string> series_by_key;
+    for (const auto& [series, files] : files_by_series) {
+      const auto [other, inserted] = series_by_key.emplace(detector_key(series), series);
+      if (!inserted) {
+        throw std::runtime_error("--output takes one run per logical address, but " +
+                                 other->second + " and " + series + " are both " +
+                                 other->first);
+      }
+    }
+  }
+
+  if (tsv) {
+    write_tsv_header(std::cout);
+    for (const auto& [series, files] : files_by_series) {
+      const auto key = detector_key(series);
+      for (const auto& file : files) {
+        convert_file(file, [&key](const hk_frame::Values& values) {
+          write_tsv_row(std::cout, key, values);
+        });
+      }
+    }
+    return 0;
+  }
+
+  for (const auto& [series, files] : files_by_series) {
+    const std::string directory =
+        output_directory.empty()
+            ? series + ".hkcol"
+            : (std::filesystem::path(output_directory) / detector_key(series)).string();
+    ColumnWriter columns(directory);
+    uint64_t frames = 0;
+    for (const auto& file : files) {
+      frames += convert_file(file, [&columns](const hk_frame::Values& values) {
+        columns.Write(values);
+      });
+    }
+    columns.Close();
+    std::cerr << series << ": " << files.size() << " files, " << frames << " frames -> "
+              << directory << "\n";
+  }
+  return 0;
+} catch (const std::exception& error) {
+  std::cerr << "Error: " << error.what() << "\n";
+  return 1;
+}
@@ -8,149 +8,736 @@
 
 #include <algorithm>
 #include <array>
+#include <csignal>
 #include <cstddef>
+#include <cstdint>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <optional>
 #include <sstream>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
+#include "calibration.hh"
+#include "channel_stats_sink.hh"
+#include "common_mode.hh"
+#include "conversion_checkpoint.hh"
+#include "decode_pipeline.hh"
 #include "detector_constants.hh"
+#include "event_filter.hh"
 #include "frame_analyzer.hh"
+#include "pedestal_sink.hh"
 #include "progress_bar.hh"
+#include "rate_sink.hh"
 #include "raw_data_file.hh"
+#include "stage_profile.hh"
 
 struct ProcessResult {
   size_t total_frames = 0;
   size_t total_events = 0;
+  size_t tree_entries = 0;
+  size_t new_frames = 0;
+  bool interrupted = false;
 };
 
 class DataFile {};
 
-auto Analyze(const std::string& input_file) -> ProcessResult {
-  std::error_code fs_error;
-  const auto file_size =
-      static_cast<size_t>(std::filesystem::file_size(input_file, fs_error));
-  if (fs_error) {
-    std::cerr << "Error: Could not read file size " << input_file << std::endl;
-    return {};
+// Products computed from the single decode pass, selected with --sinks.
+struct SinkSelection {
+  bool tree = true;
+  bool histograms = true;
+  bool pedestal = false;
+  bool rate = false;
+  bool channels = false;
+
+  [[nodiscard]] auto WritesRoot() const -> bool { return tree || histograms; }
+  // Pedestal, rate and channel summaries cover the whole file, so they need a full pass.
+  [[nodiscard]] auto Resumable() const -> bool {
+    return WritesRoot() && !pedestal && !rate && !channels;
+  }
+  // Empty for the default tree,hist, so earlier checkpoints stay valid.
+  [[nodiscard]] auto Describe() const -> std::string {
+    if (tree && histograms) {
+      return "";
+    }
+    return tree ? "sinks=tree;" : "sinks=hist;";
   }
-  RawDataFile raw_data(input_file, false);
-  const bool is_old_format = raw_data.IsOldFormat();
-  const size_t total_frames = is_old_format
-                                  ? file_size / (cdtedsd::kFrameSize + 12)
-                                  : file_size / cdtedsd::kFrameSize;
+};
 
-  std::string root_file_name = input_file + ".root";
-  auto outfile = TFile(root_file_name.c_str(), "recreate");
-  auto events = TTree("events", "events");
-
-  outfile.SetCompressionAlgorithm(ROOT::RCompressionSetting::EAlgorithm::kZSTD);
-  outfile.SetCompressionLevel(1);
-
-  cdtedsd::EventData<kAsicNum, kChannelNum> event_data{};
-  cdtedsd::FrameAnalyzer<kAsicNum, kChannelNum> frame_analyzer{};
-
-  events.Branch("ti", &event_data.ti, "ti/i");
-  events.Branch("livetime", &event_data.livetime, "livetime/i");
-  events.Branch("integral_livetime", &event_data.integral_livetime,
-                "integral_livetime/i");
-  events.Branch("trighitpat", &event_data.flag_trig_pat, "trighitpat/i");
-  events.Branch("event_counter", &event_data.event_counter, "event_counter/i");
-  events.Branch("pseudo_counter", &event_data.pseudo_counter,
-                "pseudo_counter/i");
-  events.Branch("is_pseudo_event", &event_data.is_pseudo_event,
-                "is_pseudo_event/O");
-
-  for (size_t i = 0; i < kAsicNum; ++i) {
-    std::stringstream cmn_name, cmn_type;
-    cmn_name << "cmn" << i;
-    cmn_type << "cmn" << i << "/S";
-    events.Branch(cmn_name.str().c_str(), &event_data.asic_data.at(i).cmn,
+struct ConvertOptions {
+  bool restart = false;
+  bool profile = false;
+  SinkSelection sinks{};
+  // Applies to the events tree only; histograms, pedestal and rate see every event.
+  EventFilter filter{};
+  // Adds phaN/epiN branches to the events tree when set.
+  std::optional<Calibration> calibration;
+  // A software common mode adds cmnswN branches and replaces the CMN word in
+  // pha and in the pedestal and channels sinks.
+  CommonModeEstimator common_mode{};
+
+  // Everything that changes what the tree holds.
+  [[nodiscard]] auto TreeSettings() const -> std::string {
+    std::string settings =
+        filter.Describe() + (calibration ? calibration->Describe() : std::string());
+    if (common_mode.Method() != CommonModeMethod::kHardware) {
+      settings += common_mode.Describe();
+    }
+    return settings;
+  }
+  // TreeSettings plus the ROOT products written, hashed into checkpoints.
+  [[nodiscard]] auto CheckpointSettings() const -> std::string {
+    return TreeSettings() + sinks.Describe();
+  }
+};
+
+// Frames converted between checkpoints (~256 MiB of new-format data), bounding
+// the work lost when a long conversion is interrupted.
+constexpr size_t kCheckpointIntervalFrames = 8192;
+
+volatile std::sig_atomic_t g_abort_requested = 0;
+
+void handle_abort_signal(int /*signal*/) { g_abort_requested = 1; }
+
+auto parse_sinks(const std::string& spec) -> SinkSelection {
+  SinkSelection selection{false, false, false, false, false};
+  std::stringstream stream(spec);
+  std::string name;
+  while (std::getline(stream, name, ',')) {
+    if (name == "tree") {
+      selection.tree = true;
+    } else if (name == "hist") {
+      selection.histograms = true;
+    } else if (name == "pedestal") {
+      selection.pedestal = true;
+    } else if (name == "rate") {
+      selection.rate = true;
+    } else if (name == "channels") {
+      selection.channels = true;
+    } else {
+      throw std::invalid_argument("Unknown sink '" + name +
+                                  "' (expected tree, hist, pedestal, rate, channels)");
+    }
+  }
+  if (!selection.tree && !selection.histograms && !selection.pedestal && !selection.rate &&
+      !selection.channels) {
+    throw std::invalid_argument("--sinks needs at least one sink");
+  }
+  return selection;
+}
+
+auto parse_uint32(const std::string& text, const std::string& option) -> uint32_t {
+  size_t used = 0;
+  unsigned long value = 0;  // NOLINT(google-runtime-int)
+  try {
+    value = std::stoul(text, &used, 0);
+  } catch (const std::exception&) {
+    used = 0;
+  }
+  if (text.empty() || used != text.size() || value > std::numeric_limits<uint32_t>::max()) {
+    throw std::invalid_argument(option + " expects an unsigned 32-bit value, got '" + text + "'");
+  }
+  return static_cast<uint32_t>(value);
+}
+
+// "MIN:MAX", either side may be empty for an open range.
+void parse_ti_range(const std::string& text, EventFilter& filter) {
+  const auto colon = text.find(':');
+  if (colon == std::string::npos) {
+    throw std::invalid_argument("--ti-range expects MIN:MAX, got '" + text + "'");
+  }
+  const auto min_text = text.substr(0, colon);
+  const auto max_text = text.substr(colon + 1);
+  std::optional<uint32_t> min;
+  std::optional<uint32_t> max;
+  if (!min_text.empty()) {
+    min = parse_uint32(min_text, "--ti-range");
+  }
+  if (!max_text.empty()) {
+    max = parse_uint32(max_text, "--ti-range");
+  }
+  filter.SelectTi(min, max);
+}
+
+// A number applies to every channel; anything else names a 4x64 table file.
+auto parse_thresholds(const std::string& text) -> ChannelTable {
+  size_t used = 0;
+  double value = 0.0;
+  try {
+    value = std::stod(text, &used);
+  } catch (const std::exception&) {
+    used = 0;
+  }
+  if (!text.empty() && used == text.size()) {
+    return uniform_channel_table(value);
+  }
+  return load_channel_table(text);
+}
+
+auto usable_checkpoint(const std::string& input_file, const std::string& root_file_name,
+                       size_t file_size, uint64_t selection)
+    -> std::optional<ConversionCheckpoint> {
+  auto checkpoint = load_checkpoint(checkpoint_path_for(root_file_name));
+  if (!checkpoint.has_value() || !std::filesystem::is_regular_file(root_file_name)) {
+    return std::nullopt;
+  }
+  if (checkpoint->byte_offset > file_size) {
+    std::cerr << "Warning: " << input_file
+              << " is shorter than its checkpoint, converting from the beginning." << std::endl;
+    return std::nullopt;
+  }
+  const auto fingerprint = raw_file_fingerprint(input_file, checkpoint->byte_offset);
+  if (!fingerprint.has_value() || *fingerprint != checkpoint->fingerprint) {
+    std::cerr << "Warning: " << input_file
+              << " does not match its checkpoint, converting from the beginning." << std::endl;
+    return std::nullopt;
+  }
+  if (checkpoint->selection != selection) {
+    std::cerr << "Warning: " << root_file_name
+              << " was written with a different event selection or --sinks, converting from the "
+                 "beginning."
+              << std::endl;
+    return std::nullopt;
+  }
+  return checkpoint;
+}
+
+// Attaches to an existing branch when resuming, otherwise creates it.
+void bind_branch(TTree& tree, const char* name, void* address, const char* leaflist) {
+  if (tree.GetBranch(name) != nullptr) {
+    tree.SetBranchAddress(name, address);
+  } else {
+    tree.Branch(name, address, leaflist);
+  }
+}
+
+class InvalidEventLogger : public EventSink {
+ public:
+  explicit InvalidEventLogger(size_t first_event_index) : event_index_(first_event_index) {}
+
+  void OnEvent(const DecodedEvent& event, size_t frame_index) override {
+    if (event.valid) {
+      ++event_index_;
+      return;
+    }
+    std::cout << "Warning: Invalid event at frame: " << frame_index
+              << " and index: " << event_index_ << ".";
+    std::cout << "This might be caused by data corruption or misalignment." << std::endl;
+  }
+
+ private:
+  size_t event_index_ = 0;
+};
+
+class TreeSink : public EventSink {
+ public:
+  TreeSink(TTree& tree, const EventFilter& filter, const Calibration* calibration,
+           const CommonModeEstimator& common_mode, size_t existing_entries)
+      : tree_(tree),
+        filter_(filter),
+        calibration_(calibration),
+        common_mode_(common_mode),
+        entries_(existing_entries) {
+    bind_branch(tree_, "ti", &event_.ti, "ti/i");
+    bind_branch(tree_, "livetime", &event_.livetime, "livetime/i");
+    bind_branch(tree_, "integral_livetime", &event_.integral_livetime, "integral_livetime/i");
+    bind_branch(tree_, "trighitpat", &event_.flag_trig_pat, "trighitpat/i");
+    bind_branch(tree_, "event_counter", &event_.event_counter, "event_counter/i");
+    bind_branch(tree_, "pseudo_counter", &event_.pseudo_counter, "pseudo_counter/i");
+    bind_branch(tree_, "is_pseudo_event", &event_.is_pseudo_event, "is_pseudo_event/O");
+
+    for (size_t i = 0; i < kAsicNum; ++i) {
+      std::stringstream cmn_name, cmn_type;
+      cmn_name << "cmn" << i;
+      cmn_type << "cmn" << i << "/S";
+      bind_branch(tree_, cmn_name.str().c_str(), &event_.asic_data.at(i).cmn,
                   cmn_type.str().c_str());
 
-    std::stringstream adc_name, adc_type;
-    adc_name << "adc" << i;
-    adc_type << "adc" << i << "[" << kChannelNum << "]/S";
-    events.Branch(adc_name.str().c_str(), &event_data.asic_data.at(i).adc_data,
+      std::stringstream adc_name, adc_type;
+      adc_name << "adc" << i;
+      adc_type << "adc" << i << "[" << kChannelNum << "]/S";
+      bind_branch(tree_, adc_name.str().c_str(), &event_.asic_data.at(i).adc_data,
                   adc_type.str().c_str());
 
-    std::stringstream ref_name, ref_type;
-    ref_name << "ref" << i;
-    ref_type << "ref" << i << "/S";
-    events.Branch(ref_name.str().c_str(), &event_data.asic_data.at(i).ref,
+      std::stringstream ref_name, ref_type;
+      ref_name << "ref" << i;
+      ref_type << "ref" << i << "/S";
+      bind_branch(tree_, ref_name.str().c_str(), &event_.asic_data.at(i).ref,
                   ref_type.str().c_str());
+
+      if (SoftwareCommonMode()) {
+        std::stringstream cmnsw_name, cmnsw_type;
+        cmnsw_name << "cmnsw" << i;
+        cmnsw_type << "cmnsw" << i << "/F";
+        bind_branch(tree_, cmnsw_name.str().c_str(), &software_cmn_.at(i),
+                    cmnsw_type.str().c_str());
+      }
+
+      if (calibration_ != nullptr) {
+        std::stringstream pha_name, pha_type;
+        pha_name << "pha" << i;
+        pha_type << "pha" << i << "[" << kChannelNum << "]/F";
+        bind_branch(tree_, pha_name.str().c_str(), &calibrated_.pha.at(i),
+                    pha_type.str().c_str());
+      }
+      if (calibration_ != nullptr && calibration_->HasGain()) {
+        std::stringstream epi_name, epi_type;
+        epi_name << "epi" << i;
+        epi_type << "epi" << i << "[" << kChannelNum << "]/F";
+        bind_branch(tree_, epi_name.str().c_str(), &calibrated_.epi.at(i),
+                    epi_type.str().c_str());
+      }
+    }
+  }
+
+  void OnEvent(const DecodedEvent& event, size_t /*frame_index*/) override {
+    if (!filter_.Accept(event)) {
+      return;
+    }
+    event_ = event;
+    if (SoftwareCommonMode()) {
+      for (size_t asic = 0; asic < kAsicNum; ++asic) {
+        software_cmn_[asic] = common_mode_.Estimate(event_.asic_data[asic], asic);  // NOLINT
+      }
+    }
+    if (calibration_ != nullptr) {
+      calibration_->Apply(event_, calibrated_, SoftwareCommonMode() ? &software_cmn_ : nullptr);
+    }
+    tree_.Fill();
+    ++entries_;
   }
 
-  auto histall =
-      TH2D("histall", "histall", 256, -0.5, -0.5 + 256, 1024, -0.5, 1023.5);
-  auto histall_cmn = TH2D("histall_cmn", "histall_cmn", 256, -0.5, -0.5 + 256,
-                          1024, -50.5, 1024.0 - 50.5);
+  [[nodiscard]] auto Entries() const -> size_t { return entries_; }
+
+ private:
+  [[nodiscard]] auto SoftwareCommonMode() const -> bool {
+    return common_mode_.Method() != CommonModeMethod::kHardware;
+  }
 
-  int event_counter = 0;
-  ProgressBar progress_bar(total_frames);
+  TTree& tree_;
+  const EventFilter& filter_;
+  const Calibration* calibration_ = nullptr;
+  const CommonModeEstimator& common_mode_;
+  std::array<float, kAsicNum> software_cmn_{};
+  size_t entries_ = 0;
+  DecodedEvent event_{};
+  CalibratedEvent calibrated_{};
+};
 
-  auto process_event =
-      [&](cdtedsd::EventData<kAsicNum, kChannelNum>& analyzed_event,
-          size_t frame_index) -> void {
-    if (!analyzed_event.valid) {
-      std::cout << "Warning: Invalid event at frame: " << frame_index
-                << " and index: " << event_counter << ".";
-      std::cout << "This might be caused by data corruption or misalignment."
-                << std::endl;
+class HistogramSink : public EventSink {
+ public:
+  HistogramSink(TH2D& histall, TH2D& histall_cmn) : histall_(histall), histall_cmn_(histall_cmn) {}
+
+  void OnEvent(const DecodedEvent& event, size_t /*frame_index*/) override {
+    if (!event.valid) {
       return;
     }
     for (size_t asic_index = 0; asic_index < kAsicNum; ++asic_index) {
-      const auto& asic_data = analyzed_event.asic_data[asic_index];  // NOLINT
+      const auto& asic_data = event.asic_data[asic_index];  // NOLINT
       const auto cmn = asic_data.cmn;
       for (size_t index = 0; index < kChannelNum; ++index) {
         if (!asic_data.chflag.test(index)) {
           continue;
         }
         const auto adc = asic_data.adc_data[index];  // NOLINT
-        const auto global_index =
-            static_cast<double>(asic_index * kChannelNum + index);
-        histall.Fill(global_index, adc);
-        histall_cmn.Fill(global_index, adc - cmn);
+        const auto global_index = static_cast<double>(asic_index * kChannelNum + index);
+        histall_.Fill(global_index, adc);
+        histall_cmn_.Fill(global_index, adc - cmn);
       }
     }
-    events.Fill();
-    event_counter++;
+  }
+
+ private:
+  TH2D& histall_;
+  TH2D& histall_cmn_;
+};
+
+// Per-stage costs collected with --profile.
+struct ConversionProfile {
+  StageTimes read;
+  StageTimes decode;
+  StageTimes tree_fill;
+  StageTimes hist_fill;
+  StageTimes pedestal;
+  StageTimes rate;
+  StageTimes channels;
+  StageTimes write;
+  StageTimes total;
+
+  void Print(std::ostream& out, const std::string& file) const {
+    write_stage_profile(out, file, "read", read);
+    write_stage_profile(out, file, "decode", decode);
+    write_stage_profile(out, file, "tree_fill", tree_fill);
+    write_stage_profile(out, file, "hist_fill", hist_fill);
+    write_stage_profile(out, file, "pedestal", pedestal);
+    write_stage_profile(out, file, "rate", rate);
+    write_stage_profile(out, file, "channels", channels);
+    write_stage_profile(out, file, "write", write);
+    write_stage_profile(out, file, "total", total);
+  }
+};
+
+auto Analyze(const std::string& input_file, const ConvertOptions& options, ProgressBar& progress)
+    -> ProcessResult {
+  // Process CPU: reading and decoding run on the pipeline worker.
+  const StageClock total_clock(CLOCK_PROCESS_CPUTIME_ID);
+  ConversionProfile profile;
+  const auto times = [&](StageTimes& stage) -> StageTimes* {
+    return options.profile ? &stage : nullptr;
   };
+  std::error_code fs_error;
+  const auto file_size =
+      static_cast<size_t>(std::filesystem::file_size(input_file, fs_error));
+  if (fs_error) {
+    std::cerr << "Error: Could not read file size " << input_file << std::endl;
+    return {};
+  }
+  const auto& sinks = options.sinks;
+  RawDataFile raw_data(input_file, false, &g_abort_requested);
+
+  std::string root_file_name = input_file + ".root";
+  const std::string checkpoint_path = checkpoint_path_for(root_file_name);
+  const uint64_t selection = selection_hash(options.CheckpointSettings());
+  std::optional<ConversionCheckpoint> resume;
+  if (!options.restart && sinks.Resumable()) {
+    resume = usable_checkpoint(input_file, root_file_name, file_size, selection);
+  }
+  // A complete conversion is only checked against its checkpoint, not reopened for writing.
+  const bool complete = resume.has_value() && resume->byte_offset == file_size;
+
+  std::unique_ptr<TFile> outfile;
+  TTree* events = nullptr;
+  TH2D* histall = nullptr;
+  TH2D* histall_cmn = nullptr;
+  if (sinks.WritesRoot()) {
+    outfile.reset(TFile::Open(root_file_name.c_str(),
+                              complete ? "read" : resume.has_value() ? "update" : "recreate"));
+    if (!outfile || outfile->IsZombie()) {
+      throw std::runtime_error("Could not open output file " + root_file_name);
+    }
+  }
+  if (resume.has_value()) {
+    if (sinks.tree) {
+      outfile->GetObject("events", events);
+    }
+    if (sinks.histograms) {
+      outfile->GetObject("histall", histall);
+      outfile->GetObject("histall_cmn", histall_cmn);
+    }
+    const bool tree_matches =
+        !sinks.tree ||
+        (events != nullptr &&
+         static_cast<uint64_t>(events->GetEntries()) == resume->tree_entries);
+    const bool histograms_match =
+        !sinks.histograms ||
+        (histall != nullptr && histall_cmn != nullptr &&
+         static_cast<uint64_t>(histall->GetEntries()) == resume->histogram_entries);
+    if (!tree_matches || !histograms_match) {
+      std::cerr << "Warning: " << root_file_name
+                << " does not match its checkpoint, converting from the beginning." << std::endl;
+      outfile.reset();  // close the read-only or update handle before recreating
+      outfile.reset(TFile::Open(root_file_name.c_str(), "recreate"));
+      if (!outfile || outfile->IsZombie()) {
+        throw std::runtime_error("Could not open output file " + root_file_name);
+      }
+      resume.reset();
+      events = nullptr;
+      histall = nullptr;
+      histall_cmn = nullptr;
+    }
+  }
+  if (resume.has_value() && complete) {
+    if (options.profile) {
+      total_clock.Stop(profile.total, 0, 0);
+      progress.Clear();
+      profile.Print(std::cout, input_file);
+    }
+    return {.total_frames = static_cast<size_t>(resume->frames),
+            .total_events = static_cast<size_t>(resume->events),
+            .tree_entries = static_cast<size_t>(resume->tree_entries)};
+  }
+  if (sinks.WritesRoot() && !resume.has_value()) {
+    remove_checkpoint(checkpoint_path);
+  }
+
+  if (outfile) {
+    outfile->SetCompressionAlgorithm(ROOT::RCompressionSetting::EAlgorithm::kZSTD);
+    outfile->SetCompressionLevel(1);
+  }
+
+  // Objects created below belong to outfile, which deletes them on close.
+  if (sinks.tree && events == nullptr) {
+    events = new TTree("events", "events");  // NOLINT
+  }
+  if (sinks.histograms && histall == nullptr) {
+    histall = new TH2D("histall", "histall", 256, -0.5, -0.5 + 256, 1024, -0.5,  // NOLINT
+                       1023.5);
+  }
+  if (sinks.histograms && histall_cmn == nullptr) {
+    histall_cmn = new TH2D("histall_cmn", "histall_cmn", 256, -0.5, -0.5 + 256,  // NOLINT
+                           1024, -50.5, 1024.0 - 50.5);
+  }
 
-  size_t frame_count = 0;
-  while (raw_data.GetNextFrame()) {
-    progress_bar.MaybeRender(frame_count);
-    const auto& frame = raw_data.GetFrame();
-    frame_analyzer.Initialize(
-        reinterpret_cast<const uint8_t*>(frame.data()),  // NOLINT
-        frame.size());
-    while (frame_analyzer.UnpackNextEvent(event_data)) {
-      process_event(event_data, frame_count);
+  const size_t start_frames = resume.has_value() ? static_cast<size_t>(resume->frames) : 0;
+  const size_t start_events = resume.has_value() ? static_cast<size_t>(resume->events) : 0;
+  const size_t start_entries =
+      resume.has_value() ? static_cast<size_t>(resume->tree_entries) : 0;
+  if (resume.has_value()) {
+    if (!raw_data.Seek(resume->byte_offset)) {
+      throw std::runtime_error("Could not seek " + input_file + " to checkpoint");
     }
-    frame_count++;
+    progress.Clear();
+    std::cout << "Resuming " << input_file << " at frame " << start_frames << " (byte "
+              << resume->byte_offset << ")" << std::endl;
   }
+  const size_t start_offset = resume.has_value() ? static_cast<size_t>(resume->byte_offset) : 0;
+  progress.Skip(start_offset);
 
-  progress_bar.Finish();
-  outfile.Write();
-  return {.total_frames = total_frames,
-          .total_events = static_cast<size_t>(event_counter)};
+  DecodePipeline pipeline(raw_data, start_frames, &g_abort_requested);
+  pipeline.SetThreaded(true);
+  pipeline.SetProfile(times(profile.read), times(profile.decode));
+  InvalidEventLogger invalid_event_logger(start_events);
+  pipeline.AddSink(invalid_event_logger);
+  std::optional<TreeSink> tree_sink;
+  std::optional<HistogramSink> histogram_sink;
+  std::optional<PedestalSink> pedestal_sink;
+  std::optional<RateSink> rate_sink;
+  std::optional<ChannelStatsSink> channel_stats_sink;
+  if (sinks.tree) {
+    pipeline.AddSink(tree_sink.emplace(*events, options.filter,
+                                       options.calibration ? &*options.calibration : nullptr,
+                                       options.common_mode,
+                                       start_entries),
+                     times(profile.tree_fill));
+  }
+  if (sinks.histograms) {
+    pipeline.AddSink(histogram_sink.emplace(*histall, *histall_cmn), times(profile.hist_fill));
+  }
+  if (sinks.pedestal) {
+    pipeline.AddSink(pedestal_sink.emplace(PedestalSink::kUnlimited, options.common_mode),
+                     times(profile.pedestal));
+  }
+  if (sinks.rate) {
+    pipeline.AddSink(rate_sink.emplace(), times(profile.rate));
+  }
+  if (sinks.channels) {
+    pipeline.AddSink(channel_stats_sink.emplace(PedestalSink::kUnlimited,
+                                                ChannelStatsSink::kDefaultNoisyFactor,
+                                                ChannelStatsSink::kDefaultHotFactor,
+                                                options.common_mode),
+                     times(profile.channels));
+  }
+
+  size_t frame_count = start_frames;
+  size_t event_counter = start_events;
+  uint64_t converted_offset = start_offset;
+  auto write_checkpoint = [&]() -> void {
+    if (!outfile) {
+      return;
+    }
+    const StageClock write_clock;
+    const auto bytes_before = outfile->GetBytesWritten();
+    outfile->Write(nullptr, TObject::kOverwrite);
+    if (options.profile) {
+      write_clock.Stop(profile.write,
+                       static_cast<uint64_t>(outfile->GetBytesWritten() - bytes_before));
+    }
+    ConversionCheckpoint checkpoint{};
+    checkpoint.byte_offset = converted_offset;
+    checkpoint.frames = frame_count;
+    checkpoint.events = event_counter;
+    checkpoint.histogram_entries =
+        histall != nullptr ? static_cast<uint64_t>(histall->GetEntries()) : 0;
+    checkpoint.tree_entries = tree_sink.has_value() ? tree_sink->Entries() : 0;
+    checkpoint.selection = selection;
+    checkpoint.fingerprint = raw_file_fingerprint(input_file, checkpoint.byte_offset).value_or(0);
+    if (!save_checkpoint(checkpoint_path, checkpoint)) {
+      std::cerr << "Warning: Could not write checkpoint " << checkpoint_path << std::endl;
+    }
+  };
+
+  const auto result = pipeline.Run([&](const PipelineFrameInfo& frame) -> void {
+    progress.Advance(frame.end_offset - converted_offset, frame.valid_events);
+    frame_count = frame.frame_index + 1;
+    converted_offset = frame.end_offset;
+    event_counter += frame.valid_events;
+    if ((frame_count - start_frames) % kCheckpointIntervalFrames == 0) {
+      write_checkpoint();
+    }
+  });
+
+  write_checkpoint();
+  if (pedestal_sink.has_value() && !result.aborted) {
+    const std::string pedestal_file_name = input_file + ".pedestal";
+    std::ofstream pedestal_file(pedestal_file_name);
+    if (!pedestal_file.is_open()) {
+      throw std::runtime_error("Could not open output file " + pedestal_file_name);
+    }
+    pedestal_sink->WriteTable(pedestal_file);
+  }
+  if (rate_sink.has_value() && !result.aborted) {
+    const std::string rate_file_name = input_file + ".rate";
+    std::ofstream rate_file(rate_file_name);
+    if (!rate_file.is_open()) {
+      throw std::runtime_error("Could not open output file " + rate_file_name);
+    }
+    rate_sink->WriteSummary(rate_file);
+  }
+  if (channel_stats_sink.has_value() && !result.aborted) {
+    const std::string channels_file_name = input_file + ".channels";
+    std::ofstream channels_file(channels_file_name);
+    if (!channels_file.is_open()) {
+      throw std::runtime_error("Could not open output file " + channels_file_name);
+    }
+    channel_stats_sink->WriteMap(channels_file);
+  }
+  if (options.profile) {
+    total_clock.Stop(profile.total, converted_offset - start_offset, result.events);
+    progress.Clear();
+    profile.Print(std::cout, input_file);
+  }
+  return {.total_frames = frame_count,
+          .total_events = event_counter,
+          .tree_entries = tree_sink.has_value() ? tree_sink->Entries() : 0,
+          .new_frames = frame_count - start_frames,
+          .interrupted = result.aborted};
+}
+void print_usage(const std::string& program) {
+  std::cout << "Usage: " << program
+            << " [--restart] [--profile] [--sinks LIST] [selection options] file name...\n"
+            << "  Converts raw files to <file>.root. A conversion checkpoint\n"
+            << "  (<file>.root.ckpt) lets later runs append only new frames.\n"
+            << "  --restart     Ignore any checkpoint and convert from the beginning\n"
+            << "  --profile     Print per-stage wall/CPU time and throughput per file\n"
+            << "  --sinks LIST  Comma separated products of the single decode pass\n"
+            << "                (default tree,hist):\n"
+            << "                  tree      events TTree in <file>.root\n"
+            << "                  hist      histall/histall_cmn in <file>.root\n"
+            << "                  pedestal  median pedestal table in <file>.pedestal\n"
+            << "                  rate      event rate/livetime summary in <file>.rate\n"
+            << "                  channels  noise/occupancy/bad-channel map in <file>.channels\n"
+            << "Selection options (events tree only; combined with AND):\n"
+            << "  --drop-pseudo          Skip pseudo-triggered events\n"
+            << "  --trigger MASK         Keep events whose trighitpat has any bit of MASK\n"
+            << "  --threshold VALUE|FILE Keep events with a hit at or above the ADC-CMN\n"
+            << "                         threshold (one value, or a 4x64 table file)\n"
+            << "  --ti-range MIN:MAX     Keep events with MIN <= ti <= MAX (either may be empty)\n"
+            << "Calibration options (events tree):\n"
+            << "  --pedestal FILE        Add phaN[64] = ADC - CMN - pedestal, with the\n"
+            << "                         pedestal table written by calc_pedestal\n"
+            << "  --gain FILE            Add epiN[64] = pha * gain + offset; FILE holds 4x64\n"
+            << "                         gains, optionally followed by 4x64 offsets\n"
+            << "                         (needs --pedestal)\n"
+            << "  --common-mode METHOD   hardware (default), median or mean: recompute CMN\n"
+            << "                         per event and ASIC from the flagged channels (after\n"
+            << "                         subtracting --pedestal when given), add cmnswN and\n"
+            << "                         use it for pha and the pedestal/channels sinks\n";
 }
 
 auto main(int argc, char** argv) -> int try {
   const std::vector<std::string> args(argv, argv + argc);  // NOLINT
-  if (args.size() <= 1) {
-    std::cout << "Usage: " << args.front() << " file name" << std::endl;
+  ConvertOptions options{};
+  std::vector<std::string> input_files;
+  std::optional<std::string> pedestal_file;
+  std::optional<std::string> gain_file;
+  CommonModeMethod common_mode = CommonModeMethod::kHardware;
+  for (size_t i = 1; i < args.size(); ++i) {
+    if (args[i] == "--restart") {
+      options.restart = true;
+    } else if (args[i] == "--profile") {
+      options.profile = true;
+    } else if (args[i] == "--drop-pseudo") {
+      options.filter.DropPseudo();
+    } else if (args[i] == "--sinks" || args[i] == "--trigger" || args[i] == "--threshold" ||
+               args[i] == "--ti-range" || args[i] == "--pedestal" || args[i] == "--gain" ||
+               args[i] == "--common-mode") {
+      if (i + 1 >= args.size()) {
+        print_usage(args.front());
+        return 1;
+      }
+      const auto& option = args[i];
+      const auto& value = args[++i];
+      if (option == "--sinks") {
+        options.sinks = parse_sinks(value);
+      } else if (option == "--trigger") {
+        options.filter.RequireTrigger(parse_uint32(value, option));
+      } else if (option == "--threshold") {
+        options.filter.RequireHit(parse_thresholds(value));
+      } else if (option == "--pedestal") {
+        pedestal_file = value;
+      } else if (option == "--gain") {
+        gain_file = value;
+      } else if (option == "--common-mode") {
+        common_mode = parse_common_mode(value);
+      } else {
+        parse_ti_range(value, options.filter);
+      }
+    } else if (args[i] == "-h" || args[i] == "--help") {
+      print_usage(args.front());
+      return 0;
+    } else {
+      input_files.push_back(args[i]);
+    }
+  }
+  if (input_files.empty()) {
+    print_usage(args.front());
     return 1;
   }
-  for (const auto& input_file :
-       std::vector<std::string>(args.begin() + 1, args.end())) {
-    const auto result = Analyze(input_file);
+  if (gain_file && !pedestal_file) {
+    throw std::invalid_argument("--gain needs --pedestal");
+  }
+  if (pedestal_file) {
+    options.calibration.emplace(*pedestal_file);
+    if (gain_file) {
+      options.calibration->LoadGain(*gain_file);
+    }
+  }
+  if (common_mode != CommonModeMethod::kHardware) {
+    const auto pedestal = pedestal_file ? std::optional(load_channel_table(*pedestal_file))
+                                        : std::nullopt;
+    options.common_mode = CommonModeEstimator(common_mode, pedestal ? &*pedestal : nullptr);
+  }
+  std::signal(SIGINT, handle_abort_signal);
+  std::signal(SIGTERM, handle_abort_signal);
+  // One progress report for the whole run, sized by the input bytes.
+  uint64_t total_bytes = 0;
+  for (const auto& input_file : input_files) {
+    std::error_code size_error;
+    const auto size = std::filesystem::file_size(input_file, size_error);
+    total_bytes += size_error ? 0 : static_cast<uint64_t>(size);
+  }
+  ProgressBar progress(total_bytes);
+  uint64_t finished_bytes = 0;
+  for (const auto& input_file : input_files) {
+    const auto result = Analyze(input_file, options, progress);
+    std::error_code size_error;
+    const auto size = std::filesystem::file_size(input_file, size_error);
+    finished_bytes += size_error ? 0 : static_cast<uint64_t>(size);
+    // Whatever the pass did not read (an up-to-date file, a partial trailing
+    // frame) still counts as done.
+    if (!result.interrupted && finished_bytes > progress.DoneBytes()) {
+      progress.Skip(finished_bytes - progress.DoneBytes());
+    }
+    progress.Clear();
+    if (result.interrupted) {
+      progress.Finish();
+      std::cout << "Interrupted: total_frame: " << result.total_frames
+                << " total_event: " << result.total_events << " " << input_file
+                << " (checkpoint saved)" << std::endl;
+      return 130;
+    }
     std::cout << "[100.0%] total_frame: " << result.total_frames
-              << " total_event: " << result.total_events << " " << input_file
-              << std::endl;
+              << " total_event: " << result.total_events << " new_frame: " << result.new_frames;
+    if (!options.filter.Empty()) {
+      std::cout << " selected_event: " << result.tree_entries;
+    }
+    std::cout << " " << input_file << std::endl;
   }
+  progress.Finish();
   return 0;
 } catch (const std::exception& ex) {
   std::cerr << "Error: " << ex.what() << std::endl;